@@ -33,77 +33,383 @@ std::string toStr(Metric metric)
     return("Unknown Metric");
 }
 
-void sortRows(Matrix mat, float (*key)(rvector v), uword l_index, uword r_index, bool reverse)
-{   
-    auto greater_than = [](float val, float pivot)->bool{return val > pivot;};
-    auto less_than = [](float val, float pivot)->bool{return val < pivot;};
-    bool (*i_comparison)(float, float) = less_than;
-    bool (*j_comparison)(float, float) = greater_than;
-    uword i, j, m_index;
-    float pivot;
-    i = l_index;
-    j = r_index;
-    m_index = l_index + (r_index - l_index) / 2;
-    pivot = key(mat.row(m_index));
-
-    if (reverse == true) {
-        i_comparison = greater_than;
-        j_comparison = less_than;
+/*
+Sorts the rows l_index to r_index (inclusive) of the matrix in place by a key
+of each row. The key is evaluated once per row, the order is stable.
+
+Parameters
+----------
+mat : Matrix
+    Matrix to sort.
+key : float (*)(rvector)
+    Key of a row.
+l_index, r_index : uword
+    First and last (inclusive) rows to sort.
+reverse : bool, optional
+    Sort in descending order. Defaults to false.
+*/
+void sortRows(Matrix &mat, float (*key)(rvector v), uword l_index, uword r_index, bool reverse)
+{
+    if (r_index >= mat.n_rows) {
+        throw std::out_of_range("The rows to sort are out of the matrix.\n");
     }
+    if (l_index >= r_index) {return;}
+
+    vector keys(r_index - l_index + 1);
+    for (uword i = l_index; i <= r_index; i++) {keys(i - l_index) = key(mat.row(i));}
+
+    index_vec order = arma::stable_sort_index(keys, reverse ? "descend" : "ascend");
+    Matrix block = mat.rows(l_index, r_index);
+    PermuteRowsInPlace(block, order);
+    mat.rows(l_index, r_index) = block;
+}
+
+/*
+Selects the indices of the k largest (or smallest) values with a parallel 
+partial selection instead of a full sort.
+
+Each thread keeps the best k candidates of its chunk using nth_element, 
+the candidates are merged and only the final k are ordered (when requested). 
+Ties are broken by the lower index so the result is deterministic.
+
+Parameters
+----------
+values : vector
+    Values to rank.
+k : uword
+    Number of indices to select, capped at the size of values.
+descend : bool, optional
+    Select the largest values if true, the smallest otherwise. Defaults to true.
+ordered : bool, optional
+    If true the indices are ordered by value (best first), otherwise
+    they are returned in ascending index order. Defaults to true.
+
+Returns
+-------
+index_vec
+    Indices of the selected values.
+*/
+index_vec TopKIndices(const vector &values, uword k, bool descend, bool ordered)
+{
+    uword n = values.n_elem;
+    if (k > n) {k = n;}
+    if (k == 0) {return index_vec();}
 
-    while(i < r_index || j > l_index){
-        while (i_comparison(key(mat.row(i)),pivot)) {
-            i++;
+    const float *v = values.memptr();
+    auto before = [v, descend](uword a, uword b)->bool{
+        if (v[a] != v[b]) {return descend ? (v[a] > v[b]) : (v[a] < v[b]);}
+        return a < b;
+    };
+
+    int n_threads = omp_get_max_threads();
+    std::vector<uword> candidates;
+
+    if ((n_threads > 1) && (2 * k * n_threads <= n)) {
+        // Keep the best k of each chunk, the global top k is among them
+        std::vector<std::vector<uword>> local(n_threads);
+
+        // Loop over the chunks, the team may be smaller than requested (nested calls)
+        #pragma omp parallel for schedule(static) num_threads(n_threads)
+        for (int t = 0; t < n_threads; t++)
+        {
+            uword lo = n * t / n_threads;
+            uword hi = n * (t + 1) / n_threads;
+            std::vector<uword> &chunk = local[t];
+            chunk.resize(hi - lo);
+            for (uword i = lo; i < hi; i++) {chunk[i - lo] = i;}
+            if (chunk.size() > k) {
+                std::nth_element(chunk.begin(), chunk.begin() + k, chunk.end(), before);
+                chunk.resize(k);
+            }
         }
-        while (j_comparison(key(mat.row(j)),pivot)) {
-            j--;
+
+        for (const std::vector<uword> &chunk : local) {
+            candidates.insert(candidates.end(), chunk.begin(), chunk.end());
         }
+    } else {
+        candidates.resize(n);
+        for (uword i = 0; i < n; i++) {candidates[i] = i;}
+    }
 
-        if (i <= j) {
-            mat.swap_rows(i, j);
-            i++;
-            j--;
-        } else {
-            if (i < r_index) {
-                sortRows(mat, key, i, r_index, reverse);
-            }
-            if (j > l_index) {
-                sortRows(mat, key, l_index, j, reverse);
-            }
+    if (candidates.size() > k) {
+        std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), before);
+        candidates.resize(k);
+    }
 
-            return;
+    if (ordered) {
+        std::sort(candidates.begin(), candidates.end(), before);
+    } else {
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    return arma::conv_to<index_vec>::from(candidates);
+}
+
+/*
+Selects the best values, in order, until their cumulative weight reaches a 
+target, with the partial selection of TopKIndices.
+
+The first guess is the number of rows of average weight holding the target, 
+k is doubled only while the selected weight falls short of it.
+
+Parameters
+----------
+values : vector
+    Values to rank.
+weights : arma::dvec
+    Weight of each value.
+target : double
+    Cumulative weight to reach.
+descend : bool, optional
+    Select the largest values if true, the smallest otherwise. Defaults to true.
+
+Returns
+-------
+index_vec
+    Indices of the selected values, best first. The last one is the first 
+    to reach the target, all the indices if the total weight falls short.
+*/
+index_vec TopWeightIndices(const vector &values, const arma::dvec &weights, double target, bool descend)
+{
+    uword n = values.n_elem;
+    if ((n == 0) || (target <= 0)) {return index_vec();}
+
+    double mean_weight = arma::accu(weights) / n;
+    uword k = (mean_weight > 0) ? (uword)std::ceil(target / mean_weight) : n;
+    k = std::min(std::max<uword>(k, 1), n);
+
+    while (true) {
+        index_vec top = TopKIndices(values, k, descend, true);
+        double cumulative = 0.0;
+        for (uword i = 0; i < top.n_elem; i++) {
+            cumulative += weights(top(i));
+            if (cumulative >= target) {return top.head(i + 1);}
         }
+        if (k == n) {return top;}
+        k = std::min(2 * k, n);
+    }
+}
+
+/*
+Draws a 64 bit seed for a std random engine from the armadillo generator, so
+independent streams (e.g. one per thread or restart) stay reproducible with 
+arma::arma_rng::set_seed.
+
+Returns
+-------
+unsigned long long
+    Random seed.
+*/
+unsigned long long RandomSeed()
+{
+    unsigned long long high = (unsigned long long)(arma::randu<double>() * 4294967295.0);
+    unsigned long long low = (unsigned long long)(arma::randu<double>() * 4294967295.0);
+    return (high << 32) ^ low;
+}
+
+/*
+Reads the selected rows of the chunk source one at a time. Sources that can
+gather rows more efficiently should override this.
+
+Parameters
+----------
+rows : index_vec
+    Indices of the rows to read.
+
+Returns
+-------
+Matrix (rows.n_elem, n_features)
+    Selected rows, in the order of rows.
+*/
+Matrix ChunkSource::ReadRows(const index_vec &rows) const
+{
+    Matrix result(rows.n_elem, this->n_cols());
+
+    for (uword i = 0; i < rows.n_elem; i++) {
+        result.row(i) = this->ReadRows(rows(i), rows(i));
     }
+
+    return result;
 }
 
-double Euclidian(rvector A, rvector B){
-    // Distance = sqrt(dot(A, A) - 2 * dot(A, B) + dot(B, B))
-    return sqrt(arma::sum(arma::pow(A-B, 2)));
+/*
+Groups the samples by label with a counting sort: one pass counts the samples 
+of each label, a prefix sum gives the start of each cluster and a second pass
+places the samples. Both passes are split statically between threads, each 
+thread writing its samples after those of the previous threads, so the 
+samples of each cluster stay in ascending order. O(n_samples + n_clusters).
+
+Parameters
+----------
+labels : index_vec
+    Label of each sample. Labels >= n_clusters are left out.
+n_clusters : uword
+    Number of clusters.
+
+Returns
+-------
+cluster_csr
+    Offsets (n_clusters + 1) and indices of the samples of each cluster.
+*/
+cluster_csr GroupByLabel(const index_vec &labels, uword n_clusters)
+{
+    uword N = labels.n_elem;
+    int n_threads = (N >= 65536) ? omp_get_max_threads() : 1;
+
+    // Per-thread counts, counts(c, t) for the contiguous chunk of thread t
+    arma::umat counts(n_clusters, n_threads, arma::fill::zeros);
+    uword chunk = (N + n_threads - 1) / n_threads;
+
+    #pragma omp parallel for schedule(static) num_threads(n_threads)
+    for (int t = 0; t < n_threads; t++)
+    {
+        uword start = std::min(t * chunk, N);
+        uword end = std::min(start + chunk, N);
+        uword *counts_t = counts.colptr(t);
+        for (uword i = start; i < end; i++) {
+            if (labels(i) < n_clusters) {counts_t[labels(i)]++;}
+        }
+    }
+
+    // Exclusive prefix sum over (cluster, thread) gives every write position
+    cluster_csr result;
+    result.offsets.zeros(n_clusters + 1);
+    arma::umat positions(n_clusters, n_threads);
+    uword total = 0;
+    for (uword c = 0; c < n_clusters; c++) {
+        result.offsets(c) = total;
+        for (int t = 0; t < n_threads; t++) {
+            positions(c, t) = total;
+            total += counts(c, t);
+        }
+    }
+    result.offsets(n_clusters) = total;
+    result.indices.set_size(total);
+
+    #pragma omp parallel for schedule(static) num_threads(n_threads)
+    for (int t = 0; t < n_threads; t++)
+    {
+        uword start = std::min(t * chunk, N);
+        uword end = std::min(start + chunk, N);
+        uword *positions_t = positions.colptr(t);
+        for (uword i = start; i < end; i++) {
+            if (labels(i) < n_clusters) {result.indices(positions_t[labels(i)]++) = i;}
+        }
+    }
+
+    return result;
 }
 
-double Euclidian(vector A, vector B){
-    // Distance = sqrt(dot(A, A) - 2 * dot(A, B) + dot(B, B))
-    return sqrt(arma::sum(arma::pow(A-B, 2)));
+/*
+Permutation of the samples that sorts them by label, so that every cluster is
+a contiguous block of rows of the permuted data (see PermuteRows). Built from
+the counting sort of GroupByLabel, the samples of each cluster keep their 
+order. Samples with labels >= n_clusters are placed after the last cluster.
+
+Parameters
+----------
+labels : index_vec
+    Label of each sample.
+n_clusters : uword
+    Number of clusters.
+
+Returns
+-------
+cluster_permutation
+    Order, inverse order and cluster offsets (n_clusters + 1).
+*/
+cluster_permutation ClusterPermutation(const index_vec &labels, uword n_clusters)
+{
+    uword N = labels.n_elem;
+    cluster_csr groups = GroupByLabel(labels, n_clusters);
+
+    cluster_permutation result;
+    result.offsets = groups.offsets;
+    result.order.set_size(N);
+    result.order.head(groups.indices.n_elem) = groups.indices;
+
+    uword position = groups.indices.n_elem;
+    for (uword i = 0; (i < N) && (position < N); i++) {
+        if (labels(i) >= n_clusters) {result.order(position++) = i;}
+    }
+
+    result.inverse.set_size(N);
+    #pragma omp parallel for schedule(static)
+    for (uword p = 0; p < N; p++) {
+        result.inverse(result.order(p)) = p;
+    }
+
+    return result;
 }
 
-arma::dvec MatEuclidian(Matrix A, vector B){
-    uword col_size = A.n_cols;
-    double dist;
-    arma::dvec total(col_size, arma::fill::zeros);
-    for (uword i = 0; i < col_size; i++) {
-        dist = Euclidian(A.col(i), B);
-        total(i) = dist;
+/*
+Gathers the rows of the data in the given order into a new matrix. The 
+columns are gathered in parallel, each one read and written in a single 
+stream through the column-major storage.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+order : index_vec
+    Row of the data for each row of the result, e.g. cluster_permutation::order
+    (or cluster_permutation::inverse to undo a permutation).
+
+Returns
+-------
+Matrix (order.n_elem, n_features)
+    Permuted data.
+*/
+Matrix PermuteRows(const Matrix &data, const index_vec &order)
+{
+    Matrix result(order.n_elem, data.n_cols);
+
+    #pragma omp parallel for schedule(static)
+    for (uword j = 0; j < data.n_cols; j++) {
+        const float *source = data.colptr(j);
+        float *target = result.colptr(j);
+        for (uword p = 0; p < order.n_elem; p++) {
+            target[p] = source[order(p)];
+        }
     }
-    return total;
+
+    return result;
 }
 
-arma::dvec MatEuclidian(Matrix A, rvector B){
-    uword row_size = A.n_rows;
-    double dist;
-    arma::dvec total(row_size, arma::fill::zeros);
-    for (uword i = 0; i < row_size; i++) {
-        dist = Euclidian(A.row(i), B);
-        total(i) = dist;
+/*
+Reorders the rows of the data in place by following the cycles of the 
+permutation, with one row of extra memory. Each row is moved once, O(N M).
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Dataset to reorder.
+order : index_vec (n_samples)
+    Permutation of the rows, row p of the result is row order(p) of the data.
+*/
+void PermuteRowsInPlace(Matrix &data, const index_vec &order)
+{
+    uword N = data.n_rows;
+    if (order.n_elem != N) {
+        throw std::length_error("The permutation does not match the number of rows.\n");
+    }
+
+    std::vector<bool> placed(N, false);
+    rvector buffer;
+
+    for (uword start = 0; start < N; start++) {
+        if (placed[start]) {continue;}
+        if (order(start) == start) {placed[start] = true; continue;}
+
+        // Rotate the cycle start <- order(start) <- order(order(start)) ...
+        buffer = data.row(start);
+        uword p = start;
+        while (order(p) != start) {
+            data.row(p) = data.row(order(p));
+            placed[p] = true;
+            p = order(p);
+        }
+        data.row(p) = buffer;
+        placed[p] = true;
     }
-    return total;
-}
\ No newline at end of file
+}
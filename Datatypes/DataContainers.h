@@ -3,6 +3,8 @@
 #include <armadillo>
 #include <filesystem>
 #include <stdexcept>
+#include <algorithm>
+#include <omp.h>
 
 // Armadillo unsigned integer type
 typedef arma::uword uword;
@@ -57,28 +59,117 @@ enum class AlignMethod { UNI=0, KRON, UNIFORM, KRONECKER };
 // Additional Matrix Operations
 // ****************************
 
-void sortRows(Matrix mat, float (*key)(rvector v), uword l_index, uword r_index, bool reverse = false); 
-double Euclidian(vector A, vector B);
-double Euclidian(rvector A, rvector B);
-arma::dvec MatEuclidian(Matrix A, vector B);
-arma::dvec MatEuclidian(Matrix A, rvector B);
+void sortRows(Matrix &mat, float (*key)(rvector v), uword l_index, uword r_index, bool reverse = false); 
+
+// Seed for a std random engine, drawn from the armadillo generator (reproducible with arma_rng::set_seed)
+unsigned long long RandomSeed();
+
+// Indices of the k largest (or smallest) values without sorting the whole vector
+index_vec TopKIndices(const vector &values, uword k, bool descend = true, bool ordered = true);
+
+// Best values, in order, until their cumulative weight reaches target
+index_vec TopWeightIndices(const vector &values, const arma::dvec &weights, double target, bool descend = true);
 
 // *********************
 // Other Data Containers
 // *********************
 
+// Samples grouped by label in compressed (CSR) form, the samples of cluster c
+// are indices(offsets(c)) to indices(offsets(c+1) - 1) in ascending order
+struct cluster_csr
+{
+    index_vec offsets;
+    index_vec indices;
+
+    uword n_clusters() const {return (offsets.n_elem > 0) ? offsets.n_elem - 1 : 0;}
+
+    uword size(uword c) const {return offsets(c + 1) - offsets(c);}
+
+    index_vec cluster(uword c) const {
+        return (size(c) > 0) ? index_vec(indices.subvec(offsets(c), offsets(c + 1) - 1)) : index_vec();
+    }
+};
+
+// Groups the samples by label with a single counting sort pass
+cluster_csr GroupByLabel(const index_vec &labels, uword n_clusters);
+
+// Label-sorted order of the samples, the samples of cluster c are at positions
+// offsets(c) to offsets(c+1) - 1 of the permuted data, samples with labels 
+// >= n_clusters come last
+struct cluster_permutation
+{
+    // Original row of each position
+    index_vec order;
+    // Position of each original row
+    index_vec inverse;
+    index_vec offsets;
+
+    uword n_clusters() const {return (offsets.n_elem > 0) ? offsets.n_elem - 1 : 0;}
+
+    uword size(uword c) const {return offsets(c + 1) - offsets(c);}
+};
+
+// Permutation that makes every cluster a contiguous block of rows
+cluster_permutation ClusterPermutation(const index_vec &labels, uword n_clusters);
+
+// Copy of the data with row p taken from row order(p)
+Matrix PermuteRows(const Matrix &data, const index_vec &order);
+
+// Reorders the rows of the data in place, row p becomes row order(p)
+void PermuteRowsInPlace(Matrix &data, const index_vec &order);
+
+// Row-wise access to a dataset in chunks, for datasets that may not fit in memory
+class ChunkSource
+{
+public:
+    virtual ~ChunkSource() {}
+
+    // Number of samples
+    virtual uword n_rows() const = 0;
+
+    // Number of features
+    virtual uword n_cols() const = 0;
+
+    // Rows first to last (inclusive)
+    virtual Matrix ReadRows(uword first, uword last) const = 0;
+
+    // Selected rows, in the given order
+    virtual Matrix ReadRows(const index_vec &rows) const;
+};
+
+// Chunk source over an in-memory matrix, the matrix must outlive the source
+class MatrixSource : public ChunkSource
+{
+public:
+    MatrixSource(const Matrix &data) : m_data(data) {}
+
+    uword n_rows() const override {return m_data.n_rows;}
+
+    uword n_cols() const override {return m_data.n_cols;}
+
+    Matrix ReadRows(uword first, uword last) const override {return m_data.rows(first, last);}
+
+    Matrix ReadRows(const index_vec &rows) const override {return m_data.rows(rows);}
+private:
+    const Matrix &m_data;
+};
+
 struct scores
 { 
     scores(){
         ch = 0.0;
         db = 0.0;
+        sil = 0.0;
     }
-    scores(float ch_, float db_) {
+    scores(float ch_, float db_, float sil_ = 0.0) {
         ch = ch_;
         db = db_;
+        sil = sil_;
     }
     float ch;
     float db;
+    // Silhouette score, NaN when ComputeDataScores skips it
+    float sil;
 };
 
 #endif // !DATA_CONTAINERS_H
@@ -0,0 +1,222 @@
+#include "Distances.h"
+
+/*
+Squared euclidean norm of each row of the matrix.
+
+Parameters
+----------
+A : Mat (n_samples, n_features)
+    Input matrix.
+
+Returns
+-------
+Col (n_samples)
+    Squared norm of each row.
+*/
+template <typename eT>
+arma::Col<eT> SquaredNorms(const arma::Mat<eT> &A)
+{
+    return arma::sum(arma::square(A), 1);
+}
+
+/*
+Squared distances of a tile of rows of A to a tile of rows of B, computed as
+|a|^2 - 2 a.b + |b|^2 with a single GEMM and clamped at 0 (the expanded form
+can round slightly below 0 for close rows).
+
+Parameters
+----------
+A : Mat (n_a, n_features)
+    First set of rows.
+a_norms : Col
+    Squared norm of each row of A, see SquaredNorms.
+a0, a1 : uword
+    First and last (inclusive) rows of A.
+B : Mat (n_b, n_features)
+    Second set of rows.
+b_norms : Col
+    Squared norm of each row of B.
+b0, b1 : uword
+    First and last (inclusive) rows of B.
+
+Returns
+-------
+Mat (b1 - b0 + 1, a1 - a0 + 1)
+    Squared distances, each column holds the distances of one row of A.
+*/
+template <typename eT>
+arma::Mat<eT> DistanceTile(const arma::Mat<eT> &A, const arma::Col<eT> &a_norms, uword a0, uword a1,
+                           const arma::Mat<eT> &B, const arma::Col<eT> &b_norms, uword b0, uword b1)
+{
+    arma::Mat<eT> distances = B.rows(b0, b1) * A.rows(a0, a1).t();
+    arma::Row<eT> tile_norms = a_norms.subvec(a0, a1).t();
+
+    distances *= -2;
+    distances.each_col() += b_norms.subvec(b0, b1);
+    distances.each_row() += tile_norms;
+    distances.clamp(0, INFINITY);
+
+    return distances;
+}
+
+/*
+Distances of every row of A to the row vector b. The differences are 
+accumulated column by column, streaming through the column-major storage, 
+in parallel over the rows.
+
+Parameters
+----------
+A : Mat (n_samples, n_features)
+    Set of rows.
+b : Row (n_features)
+    Reference row.
+squared : bool, optional
+    Return the squared distances. Defaults to false.
+
+Returns
+-------
+Col (n_samples)
+    Distance of each row of A to b.
+*/
+template <typename eT>
+arma::Col<eT> RowDistances(const arma::Mat<eT> &A, const arma::Row<eT> &b, bool squared)
+{
+    if (A.n_cols != b.n_elem) {
+        throw std::invalid_argument("The number of features does not match.\n");
+    }
+
+    uword N = A.n_rows;
+    uword n_blocks = (N + DISTANCE_TILE_ROWS - 1) / DISTANCE_TILE_ROWS;
+    arma::Col<eT> distances(N);
+
+    #pragma omp parallel for schedule(static)
+    for (uword t = 0; t < n_blocks; t++) {
+        uword r0 = t * DISTANCE_TILE_ROWS;
+        uword r1 = std::min(r0 + DISTANCE_TILE_ROWS, N);
+        eT *out = distances.memptr();
+        for (uword i = r0; i < r1; i++) {out[i] = 0;}
+        for (uword j = 0; j < A.n_cols; j++) {
+            const eT *column = A.colptr(j);
+            for (uword i = r0; i < r1; i++) {
+                eT d = column[i] - b(j);
+                out[i] += d * d;
+            }
+        }
+        if (!squared) {
+            for (uword i = r0; i < r1; i++) {out[i] = std::sqrt(out[i]);}
+        }
+    }
+
+    return distances;
+}
+
+/*
+Streams the distances of every row of A to every row of B without storing 
+the whole distance matrix. A is split in tiles of DISTANCE_TILE_ROWS rows 
+handled in parallel, each thread visiting the tiles of B in order for its 
+tile of A. The number of rows in a tile of B is set so that the tiles and 
+their GEMM operands of all threads fit in the memory budget.
+
+The visitor is called concurrently for different tiles of A, writes indexed
+by the rows of A (e.g. per sample sums) need no synchronization.
+
+Parameters
+----------
+A : Mat (n_a, n_features)
+    First set of rows.
+B : Mat (n_b, n_features)
+    Second set of rows.
+visit : tile_visitor
+    Called with (a0, b0, tile), tile(j, i) is the distance between the rows
+    a0 + i of A and b0 + j of B.
+squared : bool, optional
+    Visit the squared distances. Defaults to false.
+memory_budget : unsigned long long, optional
+    Bytes of the tiles of all threads. Defaults to DISTANCE_MEMORY_BUDGET.
+*/
+template <typename eT>
+void TiledDistances(const arma::Mat<eT> &A, const arma::Mat<eT> &B, const tile_visitor<eT> &visit,
+                    bool squared, unsigned long long memory_budget)
+{
+    if (A.n_cols != B.n_cols) {
+        throw std::invalid_argument("The number of features does not match.\n");
+    }
+    if ((A.n_rows == 0) || (B.n_rows == 0)) {return;}
+
+    uword M = A.n_cols;
+    uword a_rows = std::min<uword>(DISTANCE_TILE_ROWS, A.n_rows);
+    uword n_a_tiles = (A.n_rows + a_rows - 1) / a_rows;
+    int n_threads = std::max<int>(1, std::min<uword>(omp_get_max_threads(), n_a_tiles));
+
+    // Per thread: tile (a_rows x b_rows) plus the operands (a_rows + b_rows) x M
+    double thread_elements = (double)memory_budget / sizeof(eT) / n_threads;
+    double fit = (thread_elements - (double)a_rows * M) / (double)(a_rows + M);
+    uword b_rows = (uword)std::min<double>(std::max(fit, 1.0), B.n_rows);
+    uword n_b_tiles = (B.n_rows + b_rows - 1) / b_rows;
+
+    arma::Col<eT> a_norms = SquaredNorms(A);
+    arma::Col<eT> b_norms = (&A == &B) ? a_norms : SquaredNorms(B);
+
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+    for (uword ta = 0; ta < n_a_tiles; ta++) {
+        uword a0 = ta * a_rows;
+        uword a1 = std::min(a0 + a_rows, A.n_rows) - 1;
+        for (uword tb = 0; tb < n_b_tiles; tb++) {
+            uword b0 = tb * b_rows;
+            uword b1 = std::min(b0 + b_rows, B.n_rows) - 1;
+            arma::Mat<eT> tile = DistanceTile(A, a_norms, a0, a1, B, b_norms, b0, b1);
+            if (!squared) {tile = arma::sqrt(tile);}
+            visit(a0, b0, tile);
+        }
+    }
+}
+
+/*
+Distance matrix of the rows of A and B, filled tile by tile in parallel (see
+TiledDistances).
+
+Parameters
+----------
+A : Mat (n_a, n_features)
+    First set of rows.
+B : Mat (n_b, n_features)
+    Second set of rows.
+squared : bool, optional
+    Return the squared distances. Defaults to false.
+memory_budget : unsigned long long, optional
+    Bytes of the tiles of all threads, the result is not included. 
+    Defaults to DISTANCE_MEMORY_BUDGET.
+
+Returns
+-------
+Mat (n_a, n_b)
+    Distance between every row of A and every row of B.
+*/
+template <typename eT>
+arma::Mat<eT> PairwiseDistances(const arma::Mat<eT> &A, const arma::Mat<eT> &B, bool squared,
+                                unsigned long long memory_budget)
+{
+    arma::Mat<eT> distances(A.n_rows, B.n_rows);
+
+    TiledDistances<eT>(A, B, [&distances](uword a0, uword b0, const arma::Mat<eT> &tile) {
+        distances.submat(a0, b0, a0 + tile.n_cols - 1, b0 + tile.n_rows - 1) = tile.t();
+    }, squared, memory_budget);
+
+    return distances;
+}
+
+// Single and double precision instantiations
+template arma::Col<float> SquaredNorms(const arma::Mat<float>&);
+template arma::Col<double> SquaredNorms(const arma::Mat<double>&);
+template arma::Mat<float> DistanceTile(const arma::Mat<float>&, const arma::Col<float>&, uword, uword,
+                                       const arma::Mat<float>&, const arma::Col<float>&, uword, uword);
+template arma::Mat<double> DistanceTile(const arma::Mat<double>&, const arma::Col<double>&, uword, uword,
+                                        const arma::Mat<double>&, const arma::Col<double>&, uword, uword);
+template arma::Col<float> RowDistances(const arma::Mat<float>&, const arma::Row<float>&, bool);
+template arma::Col<double> RowDistances(const arma::Mat<double>&, const arma::Row<double>&, bool);
+template void TiledDistances(const arma::Mat<float>&, const arma::Mat<float>&, const tile_visitor<float>&,
+                             bool, unsigned long long);
+template void TiledDistances(const arma::Mat<double>&, const arma::Mat<double>&, const tile_visitor<double>&,
+                             bool, unsigned long long);
+template arma::Mat<float> PairwiseDistances(const arma::Mat<float>&, const arma::Mat<float>&, bool, unsigned long long);
+template arma::Mat<double> PairwiseDistances(const arma::Mat<double>&, const arma::Mat<double>&, bool, unsigned long long);
@@ -0,0 +1,39 @@
+#ifndef DISTANCES_H
+#define DISTANCES_H
+#include <functional>
+#include "DataContainers.h"
+
+// Number of rows of A in a distance tile
+#define DISTANCE_TILE_ROWS 1024
+
+// Memory (bytes) of the distance tiles and their operands across all threads
+#define DISTANCE_MEMORY_BUDGET (256ULL * 1024 * 1024)
+
+// Visitor of a distance tile, tile(j, i) is the distance of the rows a0 + i of A and b0 + j of B
+template <typename eT>
+using tile_visitor = std::function<void(uword a0, uword b0, const arma::Mat<eT> &tile)>;
+
+// Squared euclidean norm of each row
+template <typename eT>
+arma::Col<eT> SquaredNorms(const arma::Mat<eT> &A);
+
+// Squared distances (b1 - b0 + 1, a1 - a0 + 1) of the rows a0..a1 of A and b0..b1 of B with one GEMM
+template <typename eT>
+arma::Mat<eT> DistanceTile(const arma::Mat<eT> &A, const arma::Col<eT> &a_norms, uword a0, uword a1,
+                           const arma::Mat<eT> &B, const arma::Col<eT> &b_norms, uword b0, uword b1);
+
+// Distances of every row of A to b, computed directly (no cancellation)
+template <typename eT>
+arma::Col<eT> RowDistances(const arma::Mat<eT> &A, const arma::Row<eT> &b, bool squared = false);
+
+// Streams the distances of every row of A to every row of B in tiles, in parallel over the tiles of A
+template <typename eT>
+void TiledDistances(const arma::Mat<eT> &A, const arma::Mat<eT> &B, const tile_visitor<eT> &visit,
+                    bool squared = false, unsigned long long memory_budget = DISTANCE_MEMORY_BUDGET);
+
+// Distance matrix (A.n_rows, B.n_rows) of the rows of A and B
+template <typename eT>
+arma::Mat<eT> PairwiseDistances(const arma::Mat<eT> &A, const arma::Mat<eT> &B, bool squared = false,
+                                unsigned long long memory_budget = DISTANCE_MEMORY_BUDGET);
+
+#endif // !DISTANCES_H
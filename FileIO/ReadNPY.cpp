@@ -61,6 +61,166 @@ Matrix loadNPYFile(const char file_path[]){
     return PopulateMatrix(array_file, headerParams, data_start);
 }
 
+/*
+Opens a 2D NPY file for chunked reading. Only the header is read, on failure 
+the reader is left closed with zero rows.
+
+Parameters
+----------
+file_path : const char[]
+    Path of the NPY file.
+*/
+NPYChunkReader::NPYChunkReader(const char file_path[])
+{
+    this->m_file.open(file_path, ios::binary | ios::in);
+
+    if (!this->m_file) {
+        fprintf(stderr, "Unable to open %s\n", file_path);
+        this->m_file.close();
+        return;
+    }
+
+    this->m_file.seekg(8, ios::beg);
+    char size_bytes[2];
+    this->m_file.read(size_bytes, 2);
+    unsigned short h_size = ((unsigned short)size_bytes[1] << 8) | (unsigned char)size_bytes[0];
+
+    std::string hdr(h_size, '\0');
+    this->m_file.read(&hdr[0], h_size);
+    this->m_data_start = this->m_file.tellg();
+
+    HeaderNPY header = parseHeader(toString(&hdr[0], h_size), h_size);
+
+    switch (header.dtype)
+    {
+    case DataType::f4:
+        this->m_dtype_length = F_SIZE;
+        break;
+    case DataType::i4:
+        this->m_dtype_length = I4_SIZE;
+        break;
+    case DataType::i8:
+        this->m_dtype_length = I8_SIZE;
+        break;
+    case DataType::f8:
+    default:
+        this->m_dtype_length = D_SIZE;
+        break;
+    }
+
+    if (header.fortran_order) {
+        fprintf(stderr, "Fortran order arrays are currently unsupported.\n");
+        this->m_file.close();
+        return;
+    }
+
+    // Check that the file holds the whole array
+    this->m_file.seekg(0, ios::end);
+    std::streamoff data_length = this->m_file.tellg() - this->m_data_start;
+    if (data_length / this->m_dtype_length < (std::streamoff)header.M_size * header.N_size) {
+        fprintf(stderr, "Mismatching header shape (%i,%i) with data size %lli\n",
+                header.M_size, header.N_size, (long long)data_length);
+        this->m_file.close();
+        return;
+    }
+
+    this->m_dtype = header.dtype;
+    this->m_n_rows = header.M_size;
+    this->m_n_cols = header.N_size;
+}
+
+NPYChunkReader::~NPYChunkReader()
+{
+    if (this->m_file.is_open()) {this->m_file.close();}
+}
+
+/*
+Reads a contiguous block of rows.
+
+Parameters
+----------
+first : uword
+    Index of the first row.
+last : uword
+    Index of the last row (inclusive).
+
+Returns
+-------
+Matrix (last - first + 1, n_features)
+    Rows of the file as floats.
+*/
+Matrix NPYChunkReader::ReadRows(uword first, uword last) const
+{
+    if ((last < first) || (last >= this->m_n_rows)) {
+        throw std::out_of_range("Rows out of range of the NPY file.\n");
+    }
+
+    uword n_read = last - first + 1;
+    uword row_bytes = this->m_n_cols * this->m_dtype_length;
+    std::vector<char> buffer(n_read * row_bytes);
+
+    this->m_file.clear();
+    this->m_file.seekg(this->m_data_start + (std::streamoff)(first * row_bytes), ios::beg);
+    this->m_file.read(buffer.data(), buffer.size());
+
+    // Matrix is column major, the file is row major
+    Matrix block(n_read, this->m_n_cols);
+    for (uword i = 0; i < n_read; i++)
+    {
+        char *row = buffer.data() + i * row_bytes;
+        for (uword j = 0; j < this->m_n_cols; j++)
+        {
+            char *value = row + j * this->m_dtype_length;
+            switch (this->m_dtype)
+            {
+            case DataType::f4:
+                block(i, j) = GetDTypeFromBytes<float>(value);
+                break;
+            case DataType::i4:
+                block(i, j) = (float)GetDTypeFromBytes<int32_t>(value);
+                break;
+            case DataType::i8:
+                block(i, j) = (float)GetDTypeFromBytes<int64_t>(value);
+                break;
+            case DataType::f8:
+            default:
+                block(i, j) = (float)GetDTypeFromBytes<double>(value);
+                break;
+            }
+        }
+    }
+
+    return block;
+}
+
+/*
+Reads the selected rows, grouping consecutive indices into a single read.
+
+Parameters
+----------
+rows : index_vec
+    Indices of the rows to read.
+
+Returns
+-------
+Matrix (rows.n_elem, n_features)
+    Selected rows, in the order of rows.
+*/
+Matrix NPYChunkReader::ReadRows(const index_vec &rows) const
+{
+    Matrix result(rows.n_elem, this->m_n_cols);
+
+    uword start = 0;
+    while (start < rows.n_elem) {
+        uword end = start;
+        while ((end + 1 < rows.n_elem) && (rows(end + 1) == rows(end) + 1)) {end++;}
+        result.rows(start, end) = this->ReadRows(rows(start), rows(end));
+        start = end + 1;
+    }
+
+    return result;
+}
+
 HeaderNPY parseHeader(std::string header, int header_size){
 
     std::string data_code = header.substr(header.find("<")+1, 2);
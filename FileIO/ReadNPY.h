@@ -42,6 +42,33 @@ struct HeaderNPY
 
 Matrix loadNPYFile(const char file_path[]);
 
+// Reads a 2D C-order NPY file by chunks of rows without loading the whole array.
+// Not thread safe, reads share a single file stream.
+class NPYChunkReader : public ChunkSource
+{
+public:
+    NPYChunkReader(const char file_path[]);
+
+    ~NPYChunkReader();
+
+    bool is_open() const {return this->m_file.is_open();}
+
+    uword n_rows() const override {return this->m_n_rows;}
+
+    uword n_cols() const override {return this->m_n_cols;}
+
+    Matrix ReadRows(uword first, uword last) const override;
+
+    Matrix ReadRows(const index_vec &rows) const override;
+private:
+    mutable std::ifstream m_file;
+    DataType m_dtype = DataType::f8;
+    std::streampos m_data_start;
+    int m_dtype_length = 0;
+    uword m_n_rows = 0;
+    uword m_n_cols = 0;
+};
+
 HeaderNPY parseHeader(std::string header, int header_size);
 
 Matrix PopulateMatrix(std::ifstream &array_file, HeaderNPY header, std::streampos data_start);
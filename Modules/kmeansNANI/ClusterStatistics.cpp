@@ -0,0 +1,324 @@
+#include "ClusterStatistics.h"
+
+/*
+Means of the clusters from their sums and counts.
+
+Returns
+-------
+arma::dmat (n_clusters, n_features)
+    Mean of each cluster, rows of empty clusters are zero.
+*/
+arma::dmat cluster_stats::Means() const
+{
+    arma::dmat means = this->sums;
+    for (uword c = 0; c < this->counts.n_elem; c++) {
+        if (this->counts(c) > 0) {means.row(c) /= this->counts(c);}
+    }
+    return means;
+}
+
+/*
+Accumulates the number of samples, the column sums and the column sums of 
+squares of every cluster in a single pass over the data, without gathering
+the clusters. Blocks of rows are split statically between threads and the 
+thread results are merged in thread order, so the statistics do not depend 
+on scheduling.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+labels : index_vec
+    Label of each sample. Labels >= n_clusters are left out.
+n_clusters : uword
+    Number of clusters.
+weights : arma::dvec, optional
+    Weight of each sample, the counts and sums are those of the dataset with 
+    each sample repeated weights(i) times. Defaults to empty, every sample counts once.
+
+Returns
+-------
+cluster_stats
+    Counts, sums and squared sums of each cluster.
+*/
+cluster_stats ClusterStatistics(const Matrix &data, const index_vec &labels, uword n_clusters, const arma::dvec &weights)
+{
+    if (labels.n_elem != data.n_rows) {
+        throw std::invalid_argument("The number of labels does not match the number of samples.\n");
+    }
+    if (!weights.is_empty() && (weights.n_elem != data.n_rows)) {
+        throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+    }
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+
+    uword N = data.n_rows;
+    uword M = data.n_cols;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+
+    int n_threads = omp_get_max_threads();
+    std::vector<cluster_stats> t_stats(n_threads);
+    for (cluster_stats &stats_t : t_stats) {
+        stats_t.counts.zeros(n_clusters);
+        stats_t.sums.zeros(n_clusters, M);
+        stats_t.sq_sums.zeros(n_clusters, M);
+    }
+
+    #pragma omp parallel num_threads(n_threads)
+    {
+        cluster_stats &stats_t = t_stats[omp_get_thread_num()];
+
+        #pragma omp for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N);
+            for (uword i = r0; i < r1; i++) {
+                if (labels(i) < n_clusters) {stats_t.counts(labels(i)) += w ? w[i] : 1;}
+            }
+            for (uword j = 0; j < M; j++) {
+                const float *column = data.colptr(j);
+                for (uword i = r0; i < r1; i++) {
+                    if (labels(i) >= n_clusters) {continue;}
+                    double value = column[i];
+                    double w_value = w ? w[i] * value : value;
+                    stats_t.sums(labels(i), j) += w_value;
+                    stats_t.sq_sums(labels(i), j) += w_value * value;
+                }
+            }
+        }
+    }
+
+    cluster_stats stats = t_stats[0];
+    for (int t = 1; t < n_threads; t++) {
+        stats.counts += t_stats[t].counts;
+        stats.sums += t_stats[t].sums;
+        stats.sq_sums += t_stats[t].sq_sums;
+    }
+
+    return stats;
+}
+
+/*
+Within-cluster sum of squares of each cluster, sum(sq_sums - sums^2 / n).
+
+Parameters
+----------
+stats : cluster_stats
+    Cluster statistics, see ClusterStatistics.
+
+Returns
+-------
+arma::dvec
+    WCSS of each cluster (zero for empty clusters).
+*/
+arma::dvec ClusterWCSS(const cluster_stats &stats)
+{
+    arma::dvec wcss(stats.n_clusters(), arma::fill::zeros);
+
+    for (uword c = 0; c < stats.n_clusters(); c++) {
+        if (stats.counts(c) <= 0) {continue;}
+        double value = arma::accu(stats.sq_sums.row(c) - arma::square(stats.sums.row(c)) / stats.counts(c));
+        // Cancellation can leave a small negative value for tight clusters
+        wcss(c) = std::max(value, 0.0);
+    }
+
+    return wcss;
+}
+
+/*
+Extended comparison of each cluster from its column sums, e.g. the MSD of 
+each cluster, without gathering the cluster.
+
+Parameters
+----------
+stats : cluster_stats
+    Cluster statistics, see ClusterStatistics.
+metric : Metric enum {'MSD', 'RR', 'JT', etc}, optional
+    Metric of the extended comparison. Defaults to MSD.
+n_atoms : int, optional
+    Number of atoms. Defaults to 1.
+
+Returns
+-------
+vector
+    Extended comparison of each cluster, NaN for empty clusters. With 
+    weighted statistics, MSD uses the total weight of the cluster as N and 
+    the other metrics its nearest integer.
+*/
+vector ClusterComparison(const cluster_stats &stats, Metric metric, int n_atoms)
+{
+    vector comparison(stats.n_clusters());
+    comparison.fill(arma::datum::nan);
+
+    for (uword c = 0; c < stats.n_clusters(); c++) {
+        if (stats.counts(c) <= 0) {continue;}
+        rvector c_sum = arma::conv_to<rvector>::from(stats.sums.row(c));
+        rvector sq_sum = arma::conv_to<rvector>::from(stats.sq_sums.row(c));
+        if (metric == Metric::MSD) {
+            // Weighted counts need not be integers
+            comparison(c) = WeightedMSDCondensed(c_sum, sq_sum, stats.counts(c), n_atoms);
+        } else {
+            comparison(c) = ExtendedComparison(c_sum, sq_sum, metric, (int)std::llround(stats.counts(c)), n_atoms);
+        }
+    }
+
+    return comparison;
+}
+
+/*
+Calinski-Harabasz score, as sklearn.metrics.calinski_harabasz_score, from 
+the cluster statistics: BCSS = sum n_k |mean_k - mean|^2 and WCSS from the 
+squared sums. Empty clusters are left out.
+
+Parameters
+----------
+stats : cluster_stats
+    Cluster statistics, see ClusterStatistics.
+
+Returns
+-------
+float
+    Calculated Calinski and Harabasz Score.
+*/
+float CalinskiHarabaszScore(const cluster_stats &stats)
+{
+    double N = arma::accu(stats.counts);
+    double n_present = stats.n_present();
+
+    if ((n_present < 2) || (n_present >= N)) {
+        fprintf(stderr, "Number of labels is %.0f. Valid values are 2 to n_samples - 1 (inclusive)\n", n_present);
+        return 0.0f;
+    }
+
+    arma::drowvec mean = arma::sum(stats.sums, 0) / N;
+    arma::dmat means = stats.Means();
+    double bcss = 0.0;
+    for (uword c = 0; c < stats.n_clusters(); c++) {
+        if (stats.counts(c) <= 0) {continue;}
+        bcss += stats.counts(c) * arma::accu(arma::square(means.row(c) - mean));
+    }
+
+    double wcss = arma::accu(ClusterWCSS(stats));
+    if (wcss == 0) {
+        return 1.0;
+    }
+
+    return bcss * (N - n_present) / (wcss * (n_present - 1));
+}
+
+/*
+Davies-Bouldin score, as sklearn.metrics.davies_bouldin_score. The cluster 
+means come from the statistics and the scatter of each cluster (mean 
+distance to its mean) from a single parallel pass over the data, then the 
+score is the mean over clusters of max_j (s_i + s_j) / d_ij. Empty clusters
+are left out.
+
+    Examples
+    --------
+    >>> from sklearn.metrics import davies_bouldin_score
+    >>> X = [[0, 1], [1, 1], [3, 4]]
+    >>> labels = [0, 0, 1]
+    >>> davies_bouldin_score(X, labels)
+    0.12...
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+labels : index_vec
+    Label of each sample.
+stats : cluster_stats
+    Cluster statistics of the labels, see ClusterStatistics.
+weights : arma::dvec, optional
+    Weight of each sample, must match the weights of the statistics. 
+    Defaults to empty, every sample counts once.
+
+Returns
+-------
+float
+    Calculated Davies-Bouldin Score.
+*/
+float DaviesBouldinScore(const Matrix &data, const index_vec &labels, const cluster_stats &stats, const arma::dvec &weights)
+{
+    uword N = data.n_rows;
+    uword M = data.n_cols;
+    uword k = stats.n_clusters();
+    uword n_present = stats.n_present();
+    double n_samples = weights.is_empty() ? N : arma::accu(weights);
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+
+    if ((n_present < 2) || (n_present >= n_samples)) {
+        fprintf(stderr, "Number of labels is %llu. Valid values are 2 to n_samples - 1 (inclusive)\n", n_present);
+        return 0.0f;
+    }
+
+    arma::dmat means = stats.Means();
+
+    // Sum of the distances of the samples to the mean of their cluster
+    arma::dvec scatter(k, arma::fill::zeros);
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    int n_threads = omp_get_max_threads();
+    std::vector<arma::dvec> t_scatter(n_threads, arma::dvec(k, arma::fill::zeros));
+
+    #pragma omp parallel num_threads(n_threads)
+    {
+        arma::dvec &scatter_t = t_scatter[omp_get_thread_num()];
+        arma::dvec sq_distances(KMEANS_BLOCK_SIZE);
+
+        #pragma omp for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N);
+            sq_distances.zeros();
+            for (uword j = 0; j < M; j++) {
+                const float *column = data.colptr(j);
+                for (uword i = r0; i < r1; i++) {
+                    if (labels(i) >= k) {continue;}
+                    double d = column[i] - means(labels(i), j);
+                    sq_distances(i - r0) += d * d;
+                }
+            }
+            for (uword i = r0; i < r1; i++) {
+                if (labels(i) >= k) {continue;}
+                double distance = std::sqrt(sq_distances(i - r0));
+                scatter_t(labels(i)) += w ? w[i] * distance : distance;
+            }
+        }
+    }
+    for (int t = 0; t < n_threads; t++) {scatter += t_scatter[t];}
+
+    std::vector<uword> present;
+    for (uword c = 0; c < k; c++) {
+        if (stats.counts(c) > 0) {present.push_back(c);}
+    }
+
+    arma::dvec intra_distances(n_present);
+    for (uword a = 0; a < n_present; a++) {
+        intra_distances(a) = scatter(present[a]) / stats.counts(present[a]);
+    }
+
+    arma::dmat centroid_distances(n_present, n_present, arma::fill::zeros);
+    for (uword a = 0; a < n_present; a++) {
+        for (uword b = a + 1; b < n_present; b++) {
+            double d = arma::norm(means.row(present[a]) - means.row(present[b]));
+            centroid_distances(a, b) = d;
+            centroid_distances(b, a) = d;
+        }
+    }
+
+    if (arma::all(arma::abs(intra_distances) <= 1e-8) || arma::all(arma::vectorise(arma::abs(centroid_distances)) <= 1e-8)) {
+        return 0.0f;
+    }
+
+    double total = 0.0;
+    for (uword a = 0; a < n_present; a++) {
+        double worst = 0.0;
+        for (uword b = 0; b < n_present; b++) {
+            // Coinciding centroids are infinitely far apart, as in sklearn
+            if ((b == a) || (centroid_distances(a, b) == 0)) {continue;}
+            worst = std::max(worst, (intra_distances(a) + intra_distances(b)) / centroid_distances(a, b));
+        }
+        total += worst;
+    }
+
+    return total / n_present;
+}
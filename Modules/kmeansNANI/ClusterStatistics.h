@@ -0,0 +1,45 @@
+#ifndef CLUSTER_STATISTICS_H
+#define CLUSTER_STATISTICS_H
+#include "../../Datatypes/DataContainers.h"
+#include "../../Tools/BTS/ExtendedComparison.h"
+#include "KmeansEngine.h"
+
+// Per-cluster sufficient statistics of a labelled dataset
+struct cluster_stats
+{
+    // Number of samples of each cluster (n_clusters)
+    arma::dvec counts;
+    // Column sum of each cluster (n_clusters, n_features)
+    arma::dmat sums;
+    // Column sum of squares of each cluster (n_clusters, n_features)
+    arma::dmat sq_sums;
+
+    uword n_clusters() const {return counts.n_elem;}
+
+    // Number of non-empty clusters
+    uword n_present() const {return arma::accu(counts > 0);}
+
+    // Cluster means, rows of empty clusters are zero (n_clusters, n_features)
+    arma::dmat Means() const;
+};
+
+// Counts, sums and squared sums of every cluster in one parallel pass, samples count weights(i) times if given
+cluster_stats ClusterStatistics(
+    const Matrix &data, const index_vec &labels, uword n_clusters,
+    const arma::dvec &weights = arma::dvec());
+
+// Within-cluster sum of squares of each cluster
+arma::dvec ClusterWCSS(const cluster_stats &stats);
+
+// Extended comparison of each cluster (NaN for empty clusters)
+vector ClusterComparison(const cluster_stats &stats, Metric metric = Metric::MSD, int n_atoms = 1);
+
+// Calinski-Harabasz score from the cluster statistics
+float CalinskiHarabaszScore(const cluster_stats &stats);
+
+// Davies-Bouldin score, one pass over the data for the distances to the cluster means
+float DaviesBouldinScore(
+    const Matrix &data, const index_vec &labels, const cluster_stats &stats,
+    const arma::dvec &weights = arma::dvec());
+
+#endif // !CLUSTER_STATISTICS_H
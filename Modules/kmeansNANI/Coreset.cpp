@@ -0,0 +1,291 @@
+#include "Coreset.h"
+
+/*
+Heuristic number of importance sampling draws for a coreset whose cost is 
+within a relative error of the cost of the full dataset.
+
+The size follows the lightweight coreset bound (Bachem, Lucic and Krause, 
+2018), m = c (d k log k + log(1 / delta)) / epsilon^2 draws, doubled since 
+the sampling distribution of BuildCoreset is at least half of theirs. The 
+absolute constant c of the theorem is unknown and is taken as 1, so this is
+only a sizing rule and delivers no guarantee. The error of a built coreset 
+for given centers is bounded by CoresetErrorBound.
+
+Parameters
+----------
+n_features : uword
+    Number of features (d).
+n_clusters : uword
+    Number of clusters (k).
+target_error : double
+    Targeted relative error (epsilon).
+delta : double, optional
+    Failure probability. Defaults to CORESET_DELTA.
+
+Returns
+-------
+uword
+    Number of draws.
+*/
+uword CoresetSize(uword n_features, uword n_clusters, double target_error, double delta)
+{
+    if ((target_error <= 0) || (delta <= 0) || (delta >= 1)) {
+        throw std::invalid_argument("The coreset error must be positive and the failure probability in (0, 1).\n");
+    }
+    double k = std::max<double>(n_clusters, 2);
+    return (uword)std::ceil(2.0 * (n_features * k * std::log(k) + std::log(1.0 / delta)) / (target_error * target_error));
+}
+
+/*
+Squared distance of every row of a chunk to a center. Blocks of rows are
+split statically between threads and each block is read column by column.
+*/
+static arma::dvec CenterDistances(const Matrix &chunk, const arma::drowvec &center)
+{
+    uword N = chunk.n_rows;
+    uword M = chunk.n_cols;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    arma::dvec distances(N, arma::fill::zeros);
+
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N);
+        for (uword j = 0; j < M; j++) {
+            const float *column = chunk.colptr(j);
+            double c = center(j);
+            for (uword i = r0; i < r1; i++) {
+                double d = column[i] - c;
+                distances(i) += d * d;
+            }
+        }
+    }
+
+    return distances;
+}
+
+/*
+Builds a coreset of the rows of source by importance sampling, so NANI and
+k-means can run on m << n_samples weighted rows.
+
+The sampling probability of row i mixes a uniform term, its complementary
+similarity deficit and its distance to the medoid,
+
+    q_i = 1 / (2 N) + (A - csim_i) / (4 sum_j (A - csim_j)) + |x_i - x_med|^2 / (4 sum_j |x_j - x_med|^2)
+
+where A is the complementary similarity of an object at the mean. For MSD,
+csim_i = A - 2 N |x_i - mean|^2 / ((N - 1)^2 n_atoms), so the comp sim term
+is |x_i - mean|^2 / sum_j |x_j - mean|^2 (independent of n_atoms) and the 
+medoid is the row closest to the mean. Each of the m draws picks a row from
+q, and a row drawn h times gets the weight h / (m q_i), so the weighted cost 
+of the coreset is an unbiased estimate of the cost of the full dataset for 
+any centers. CoresetErrorBound bounds its error for given centers.
+
+All the totals follow from the column sums, so the rows are streamed three
+times, chunk_size at a time: the column sums, the medoid, then the sampling.
+
+Parameters
+----------
+source : ChunkSource
+    Input dataset (n_samples, n_features), e.g. a NPYChunkReader.
+m : uword
+    Number of draws, the coreset holds at most m distinct rows.
+seed : unsigned long long, optional
+    Seed of the draws. Defaults to 0.
+delta : double, optional
+    Failure probability of CoresetErrorBound. Defaults to CORESET_DELTA.
+chunk_size : uword, optional
+    Number of rows per chunk. Defaults to STREAM_CHUNK_SIZE.
+
+Returns
+-------
+coreset
+    Sampled rows, their weights and original rows, the number of draws, 
+    the mean, the medoid and the cost of the dataset to its mean.
+*/
+coreset BuildCoreset(const ChunkSource &source, uword m,
+                     unsigned long long seed, double delta, uword chunk_size)
+{
+    uword N = source.n_rows();
+    uword M = source.n_cols();
+
+    if ((N == 0) || (m == 0)) {
+        throw std::invalid_argument("The dataset and the coreset size must not be empty.\n");
+    }
+    if (chunk_size == 0) {chunk_size = STREAM_CHUNK_SIZE;}
+
+    // Column sums and total squared norm
+    arma::drowvec c_sum(M, arma::fill::zeros);
+    arma::drowvec sq_sum(M, arma::fill::zeros);
+    for (uword first = 0; first < N; first += chunk_size) {
+        Matrix chunk = source.ReadRows(first, std::min(first + chunk_size, N) - 1);
+        #pragma omp parallel for schedule(static)
+        for (uword j = 0; j < M; j++) {
+            const float *column = chunk.colptr(j);
+            double c = 0.0;
+            double sq = 0.0;
+            for (uword i = 0; i < chunk.n_rows; i++) {
+                c += column[i];
+                sq += (double)column[i] * column[i];
+            }
+            c_sum(j) += c;
+            sq_sum(j) += sq;
+        }
+    }
+    arma::drowvec mean = c_sum / N;
+    double sq_total = arma::accu(sq_sum);
+
+    // Medoid, the highest comp sim is the row closest to the mean
+    coreset core;
+    core.n_samples = N;
+    core.delta = delta;
+    double min_distance = arma::datum::inf;
+    arma::drowvec medoid(M);
+    for (uword first = 0; first < N; first += chunk_size) {
+        Matrix chunk = source.ReadRows(first, std::min(first + chunk_size, N) - 1);
+        arma::dvec distances = CenterDistances(chunk, mean);
+        uword best = distances.index_min();
+        if (distances(best) < min_distance) {
+            min_distance = distances(best);
+            core.medoid = first + best;
+            medoid = arma::conv_to<arma::drowvec>::from(chunk.row(best));
+        }
+    }
+
+    // Totals of both sensitivities from the column sums
+    core.data_cost = std::max(sq_total - arma::dot(c_sum, c_sum) / N, 0.0);
+    double medoid_cost = std::max(sq_total - 2 * arma::dot(medoid, c_sum) + N * arma::dot(medoid, medoid), 0.0);
+
+    // Sorted uniform draws, matched to the rows by the cumulative probability
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> draws(m);
+    for (double &draw : draws) {draw = uniform(generator);}
+    std::sort(draws.begin(), draws.end());
+
+    std::vector<uword> rows;
+    std::vector<double> weights;
+    std::vector<float> frames;
+    double cumulative = 0.0;
+    uword next = 0;
+
+    for (uword first = 0; (first < N) && (next < m); first += chunk_size) {
+        Matrix chunk = source.ReadRows(first, std::min(first + chunk_size, N) - 1);
+        arma::dvec mean_distances = CenterDistances(chunk, mean);
+        arma::dvec medoid_distances = CenterDistances(chunk, medoid);
+
+        for (uword a = 0; (a < chunk.n_rows) && (next < m); a++) {
+            double q = 0.5 / N;
+            q += (core.data_cost > 0) ? 0.25 * mean_distances(a) / core.data_cost : 0.25 / N;
+            q += (medoid_cost > 0) ? 0.25 * medoid_distances(a) / medoid_cost : 0.25 / N;
+            cumulative += q;
+
+            // Rounding leftovers go to the last row
+            double upper = (first + a == N - 1) ? arma::datum::inf : cumulative;
+            uword hits = 0;
+            while ((next < m) && (draws[next] < upper)) {hits++; next++;}
+            if (hits == 0) {continue;}
+
+            rows.push_back(first + a);
+            weights.push_back(hits / (m * q));
+            for (uword j = 0; j < M; j++) {frames.push_back(chunk(a, j));}
+        }
+    }
+
+    core.rows = arma::conv_to<index_vec>::from(rows);
+    core.weights = arma::dvec(weights);
+    core.frames = Matrix(frames.data(), M, rows.size()).t();
+    core.n_draws = m;
+    core.mean = mean;
+
+    return core;
+}
+
+/*
+Coreset of an in-memory matrix. See BuildCoreset with a ChunkSource.
+*/
+coreset BuildCoreset(const Matrix &data, uword m,
+                     unsigned long long seed, double delta, uword chunk_size)
+{
+    MatrixSource source(data);
+    return BuildCoreset(source, m, seed, delta, chunk_size);
+}
+
+/*
+Weighted k-means cost of the coreset, the estimate of the cost of the full
+dataset for the given centroids.
+
+Parameters
+----------
+core : coreset
+    Coreset, see BuildCoreset.
+centroids : Matrix (n_clusters, n_features)
+    Centroids.
+
+Returns
+-------
+double
+    Sum of the weighted squared distances of the coreset rows to their closest centroid.
+*/
+double CoresetCost(const coreset &core, const Matrix &centroids)
+{
+    if (core.size() == 0) {return 0.0;}
+    vector min_distances;
+    AssignLabels(core.frames, RowSquaredNorms(core.frames), centroids, min_distances);
+    return arma::dot(core.weights, arma::conv_to<arma::dvec>::from(min_distances));
+}
+
+/*
+Bound on the error of the coreset cost for given centroids, from Bernstein's
+inequality on the importance sampling estimator.
+
+CoresetCost is the mean over the m draws of Y = f(x) / q(x), where f is the
+squared distance to the closest centroid and q the sampling probability of 
+BuildCoreset, so E[Y] = cost(X, Q). With mu the mean of the dataset and 
+D = sum_i |x_i - mu|^2 (data_cost), f(x) <= 2 |x - mu|^2 + 2 f(mu) and 
+q(x) >= |x - mu|^2 / (4 D), q(x) >= 1 / (2 N) give
+
+    0 <= Y <= B = 8 D + 4 N f(mu),    Var(Y) <= E[Y^2] <= B cost(X, Q)
+
+and, with L = log(2 / delta) and a = B L / m, Bernstein's inequality gives 
+with probability at least 1 - delta
+
+    |CoresetCost - cost(X, Q)| <= sqrt(2 a cost(X, Q)) + 2 a / 3
+
+The unknown cost is replaced by its largest value consistent with the 
+estimate. The bound holds for centroids chosen independently of the draws 
+(e.g. fitted on the full dataset or another sample). For centroids fitted on
+the coreset itself it is indicative only, a bound uniform over every set of
+k centers needs the union bound of the coreset theorems.
+
+Parameters
+----------
+core : coreset
+    Coreset, see BuildCoreset.
+centroids : Matrix (n_clusters, n_features)
+    Centroids.
+
+Returns
+-------
+double
+    Bound on |CoresetCost(core, centroids) - cost(X, centroids)|, holding 
+    with probability at least 1 - core.delta.
+*/
+double CoresetErrorBound(const coreset &core, const Matrix &centroids)
+{
+    if (core.n_draws == 0) {return arma::datum::inf;}
+
+    double estimate = CoresetCost(core, centroids);
+    double mean_cost = arma::datum::inf;
+    for (uword c = 0; c < centroids.n_rows; c++) {
+        arma::drowvec shift = arma::conv_to<arma::drowvec>::from(centroids.row(c)) - core.mean;
+        mean_cost = std::min(mean_cost, arma::dot(shift, shift));
+    }
+
+    double bound = 8.0 * core.data_cost + 4.0 * core.n_samples * mean_cost;
+    double a = bound * std::log(2.0 / core.delta) / core.n_draws;
+    // Largest sqrt(cost) with cost - sqrt(2 a cost) - 2 a / 3 <= estimate
+    double root = (std::sqrt(2.0 * a) + std::sqrt(2.0 * a + 4.0 * (estimate + 2.0 * a / 3.0))) / 2.0;
+
+    return std::sqrt(2.0 * a) * root + 2.0 * a / 3.0;
+}
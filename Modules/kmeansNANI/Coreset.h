@@ -0,0 +1,55 @@
+#ifndef CORESET_H
+#define CORESET_H
+#include <random>
+#include "../../Datatypes/DataContainers.h"
+#include "KmeansEngine.h"
+#include "MiniBatch.h"
+
+// Default failure probability of the coreset error bound
+#define CORESET_DELTA 0.05
+
+// Weighted sample whose k-means cost approximates the cost of the full dataset
+struct coreset
+{
+    // Sampled frames (size, n_features)
+    Matrix frames;
+    // Importance weight of each sampled frame, sums to n_samples in expectation
+    arma::dvec weights;
+    // Original row of each sampled frame
+    index_vec rows;
+    // Number of draws (m), a frame drawn h times has the weight h / (m q)
+    uword n_draws = 0;
+    // Number of samples of the full dataset
+    uword n_samples = 0;
+    // Mean of the full dataset
+    arma::drowvec mean;
+    // Row of the medoid (highest complementary similarity) of the full dataset
+    uword medoid = 0;
+    // Cost of the full dataset with its mean as a single center, see CoresetErrorBound
+    double data_cost = 0.0;
+    // Failure probability of CoresetErrorBound
+    double delta = CORESET_DELTA;
+
+    uword size() const {return frames.n_rows;}
+};
+
+// Heuristic number of draws for a targeted relative error, a sizing rule with no guarantee (the constant of the bound is taken as 1)
+uword CoresetSize(uword n_features, uword n_clusters, double target_error, double delta = CORESET_DELTA);
+
+// Importance sampling of m rows by complementary similarity and distance to the medoid, in three streaming passes
+coreset BuildCoreset(const ChunkSource &source, uword m,
+                     unsigned long long seed = 0, double delta = CORESET_DELTA,
+                     uword chunk_size = STREAM_CHUNK_SIZE);
+
+// Coreset of an in-memory matrix
+coreset BuildCoreset(const Matrix &data, uword m,
+                     unsigned long long seed = 0, double delta = CORESET_DELTA,
+                     uword chunk_size = STREAM_CHUNK_SIZE);
+
+// Weighted k-means cost of the coreset for the centroids (n_clusters, n_features)
+double CoresetCost(const coreset &core, const Matrix &centroids);
+
+// Bernstein bound on |CoresetCost - full cost| with probability 1 - delta, for centroids independent of the draws
+double CoresetErrorBound(const coreset &core, const Matrix &centroids);
+
+#endif // !CORESET_H
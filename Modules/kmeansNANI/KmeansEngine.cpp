@@ -0,0 +1,841 @@
+#include "KmeansEngine.h"
+
+std::string toStr(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Algorithm::LLOYD:
+        return std::string("lloyd");
+    case Algorithm::HAMERLY:
+        return std::string("hamerly");
+    case Algorithm::ELKAN:
+        return std::string("elkan");
+    default:
+        return std::string("algorithm");
+    }
+}
+
+/*
+Squared distances of the rows r0..r1 of data to every centroid, computed as 
+|x|^2 - 2 x.c + |c|^2 with a single GEMM (see DistanceTile).
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+data_norms : vector
+    Squared norm of each sample, see RowSquaredNorms.
+r0, r1 : uword
+    First and last (inclusive) rows of the block.
+centroids : Matrix (n_clusters, n_features)
+    Centroids.
+c_norms : vector
+    Squared norm of each centroid.
+
+Returns
+-------
+Matrix (n_clusters, r1 - r0 + 1)
+    Squared distances, each column holds the distances of one sample.
+*/
+Matrix BlockDistances(const Matrix &data, const vector &data_norms, uword r0, uword r1,
+                      const Matrix &centroids, const vector &c_norms)
+{
+    return DistanceTile(data, data_norms, r0, r1, centroids, c_norms, 0, centroids.n_rows - 1);
+}
+
+/*
+Euclidean distance between the sample i and the centroid c.
+*/
+static inline float PointDistance(const Matrix &data, uword i, const Matrix &centroids, uword c)
+{
+    double acc = 0.0;
+    for (uword j = 0; j < data.n_cols; j++) {
+        double d = data(i, j) - centroids(c, j);
+        acc += d * d;
+    }
+    return std::sqrt(acc);
+}
+
+/*
+Euclidean distances between the sample i and every centroid.
+*/
+static inline void PointDistances(const Matrix &data, uword i, const Matrix &centroids, std::vector<double> &distances)
+{
+    uword k = centroids.n_rows;
+    std::fill(distances.begin(), distances.end(), 0.0);
+    for (uword j = 0; j < data.n_cols; j++) {
+        double x = data(i, j);
+        const float *column = centroids.colptr(j);
+        for (uword c = 0; c < k; c++) {
+            double d = x - column[c];
+            distances[c] += d * d;
+        }
+    }
+    for (uword c = 0; c < k; c++) {distances[c] = std::sqrt(distances[c]);}
+}
+
+/*
+Accumulates the per-cluster sums and counts of the samples. Blocks of rows
+are split statically between threads and the thread results are merged in
+thread order, so the sums do not depend on scheduling. With weights, sample i
+counts weights(i) times, an empty weight vector counts every sample once.
+*/
+static void AccumulateSums(const Matrix &data, const index_vec &labels, uword k, arma::dmat &sums, arma::dvec &counts,
+                           const arma::dvec &weights)
+{
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+    uword N = data.n_rows;
+    uword M = data.n_cols;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+
+    // Zeroed up front, the team may be smaller than requested (nested calls)
+    int n_threads = omp_get_max_threads();
+    std::vector<arma::dmat> t_sums(n_threads, arma::dmat(k, M, arma::fill::zeros));
+    std::vector<arma::dvec> t_counts(n_threads, arma::dvec(k, arma::fill::zeros));
+
+    #pragma omp parallel num_threads(n_threads)
+    {
+        int t = omp_get_thread_num();
+        arma::dmat &sums_t = t_sums[t];
+        arma::dvec &counts_t = t_counts[t];
+
+        #pragma omp for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N);
+            for (uword i = r0; i < r1; i++) {counts_t(labels(i)) += w ? w[i] : 1;}
+            for (uword j = 0; j < M; j++) {
+                const float *column = data.colptr(j);
+                for (uword i = r0; i < r1; i++) {
+                    sums_t(labels(i), j) += w ? w[i] * column[i] : column[i];
+                }
+            }
+        }
+    }
+
+    sums.zeros(k, M);
+    counts.zeros(k);
+    for (int t = 0; t < n_threads; t++) {
+        sums += t_sums[t];
+        counts += t_counts[t];
+    }
+}
+
+/*
+Moves the centroids to the mean of their samples, empty clusters keep their
+previous centroid.
+
+Returns
+-------
+double
+    Total squared shift of the centroids. movement holds the shift of each centroid.
+*/
+static double UpdateCentroids(Matrix &centroids, const arma::dmat &sums, const arma::dvec &counts, vector &movement)
+{
+    uword k = centroids.n_rows;
+    double shift = 0.0;
+    movement.zeros(k);
+
+    for (uword c = 0; c < k; c++) {
+        if (counts(c) <= 0) {continue;}
+        rvector new_centroid = arma::conv_to<rvector>::from(sums.row(c) / counts(c));
+        double sq_shift = arma::accu(arma::square(new_centroid - centroids.row(c)));
+        movement(c) = std::sqrt(sq_shift);
+        shift += sq_shift;
+        centroids.row(c) = new_centroid;
+    }
+
+    return shift;
+}
+
+/*
+Squared distance of every sample to the centroid of its label.
+
+Returns
+-------
+double
+    Inertia of the labels, each distance counts weights(i) times if weights is not empty.
+*/
+static double LabelInertia(const Matrix &data, const Matrix &centroids, const index_vec &labels, vector &min_distances,
+                           const arma::dvec &weights)
+{
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+    uword N = data.n_rows;
+    uword M = data.n_cols;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    double inertia = 0.0;
+
+    min_distances.zeros(N);
+
+    #pragma omp parallel for schedule(static) reduction(+:inertia)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N);
+        for (uword j = 0; j < M; j++) {
+            const float *column = data.colptr(j);
+            for (uword i = r0; i < r1; i++) {
+                float d = column[i] - centroids(labels(i), j);
+                min_distances(i) += d * d;
+            }
+        }
+        for (uword i = r0; i < r1; i++) {inertia += w ? w[i] * min_distances(i) : min_distances(i);}
+    }
+
+    return inertia;
+}
+
+/*
+Half of the distance of each centroid to its closest other centroid. 
+A sample closer than that to its centroid cannot change cluster.
+*/
+static vector HalfSeparation(const Matrix &centroids, Matrix &centroid_distances)
+{
+    uword k = centroids.n_rows;
+    vector c_norms = RowSquaredNorms(centroids);
+    centroid_distances = BlockDistances(centroids, c_norms, 0, k-1, centroids, c_norms);
+    centroid_distances = arma::sqrt(centroid_distances);
+
+    vector half_sep(k);
+    for (uword c = 0; c < k; c++) {
+        float closest = INFINITY;
+        for (uword o = 0; o < k; o++) {
+            if ((o != c) && (centroid_distances(o, c) < closest)) {closest = centroid_distances(o, c);}
+        }
+        half_sep(c) = 0.5 * closest;
+    }
+
+    return half_sep;
+}
+
+/*
+Assigns every sample to its closest centroid and accumulates the per-cluster
+sums of the samples for the next centroid update.
+
+Distances are computed block by block (see BlockDistances). Blocks are split 
+statically between threads, each thread accumulates into its own sums and 
+counts, and the thread results are merged in thread order so the result does 
+not depend on scheduling.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+data_norms : vector
+    Squared norm of each sample.
+centroids : Matrix (n_clusters, n_features)
+    Current centroids.
+labels : index_vec
+    Labels of the previous iteration, updated in place.
+min_distances : vector
+    Squared distance of each sample to its closest centroid, updated in place.
+sums : arma::dmat (n_clusters, n_features)
+    Output sum of the samples of each cluster.
+counts : arma::dvec
+    Output number (total weight) of samples of each cluster.
+n_changed : uword
+    Output number of samples whose label changed.
+weights : arma::dvec
+    Weight of each sample, empty if every sample counts once.
+
+Returns
+-------
+double
+    Inertia of the assignment.
+*/
+static double AssignAndAccumulate(
+    const Matrix &data, const vector &data_norms, const Matrix &centroids,
+    index_vec &labels, vector &min_distances, arma::dmat &sums, arma::dvec &counts,
+    uword &n_changed, const arma::dvec &weights)
+{
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+    uword N = data.n_rows;
+    uword M = data.n_cols;
+    uword k = centroids.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    vector c_norms = RowSquaredNorms(centroids);
+
+    int n_threads = omp_get_max_threads();
+    std::vector<arma::dmat> t_sums(n_threads, arma::dmat(k, M, arma::fill::zeros));
+    std::vector<arma::dvec> t_counts(n_threads, arma::dvec(k, arma::fill::zeros));
+    std::vector<double> t_inertia(n_threads, 0.0);
+    std::vector<uword> t_changed(n_threads, 0);
+
+    #pragma omp parallel num_threads(n_threads)
+    {
+        int t = omp_get_thread_num();
+        arma::dmat &sums_t = t_sums[t];
+        arma::dvec &counts_t = t_counts[t];
+
+        #pragma omp for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+            Matrix distances = BlockDistances(data, data_norms, r0, r1, centroids, c_norms);
+
+            for (uword a = 0; a < distances.n_cols; a++) {
+                uword i = r0 + a;
+                uword best_k = distances.col(a).index_min();
+                float best = distances(best_k, a);
+                if (labels(i) != best_k) {t_changed[t]++;}
+                labels(i) = best_k;
+                min_distances(i) = best;
+                t_inertia[t] += w ? w[i] * best : best;
+                counts_t(best_k) += w ? w[i] : 1;
+            }
+
+            for (uword j = 0; j < M; j++) {
+                const float *column = data.colptr(j);
+                for (uword i = r0; i <= r1; i++) {
+                    sums_t(labels(i), j) += w ? w[i] * column[i] : column[i];
+                }
+            }
+        }
+    }
+
+    // Deterministic merge of the thread accumulators
+    sums.zeros(k, M);
+    counts.zeros(k);
+    double inertia = 0.0;
+    n_changed = 0;
+    for (int t = 0; t < n_threads; t++) {
+        sums += t_sums[t];
+        counts += t_counts[t];
+        inertia += t_inertia[t];
+        n_changed += t_changed[t];
+    }
+
+    return inertia;
+}
+
+/*
+Calculates the squared euclidean norm of each row of the matrix.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+
+Returns
+-------
+vector
+    Squared norm of each row.
+*/
+vector RowSquaredNorms(const Matrix &data)
+{
+    return arma::sum(arma::square(data), 1);
+}
+
+/*
+Converts a relative tolerance to an absolute tolerance on the squared centroid
+shift, scaled by the mean variance of the features (as in scikit-learn).
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+tolerance : float
+    Relative tolerance.
+
+Returns
+-------
+double
+    Absolute tolerance.
+*/
+double ScaledTolerance(const Matrix &data, float tolerance)
+{
+    if ((tolerance <= 0) || (data.n_rows < 2)) {return 0.0;}
+    return tolerance * arma::mean(arma::var(data, 0, 0));
+}
+
+/*
+Converts a relative tolerance to an absolute one for a weighted dataset, using
+the variance of the dataset with each sample repeated weights(i) times.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+weights : arma::dvec
+    Weight of each sample, empty if every sample counts once.
+tolerance : float
+    Relative tolerance.
+
+Returns
+-------
+double
+    Absolute tolerance.
+*/
+double ScaledTolerance(const Matrix &data, const arma::dvec &weights, float tolerance)
+{
+    if (weights.is_empty()) {return ScaledTolerance(data, tolerance);}
+
+    double W = arma::accu(weights);
+    if ((tolerance <= 0) || (W <= 1)) {return 0.0;}
+
+    arma::drowvec c_sum = weights.t() * arma::conv_to<arma::dmat>::from(data);
+    arma::drowvec sq_sum = weights.t() * arma::square(arma::conv_to<arma::dmat>::from(data));
+    arma::drowvec var = (sq_sum - arma::square(c_sum) / W) / (W - 1);
+
+    return tolerance * arma::mean(var);
+}
+
+/*
+Assigns every row of data to its closest centroid.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+data_norms : vector
+    Squared norm of each sample, see RowSquaredNorms.
+centroids : Matrix (n_clusters, n_features)
+    Centroids.
+min_distances : vector
+    Output squared distance of each sample to its closest centroid.
+
+Returns
+-------
+index_vec
+    Label of each sample.
+*/
+index_vec AssignLabels(const Matrix &data, const vector &data_norms, const Matrix &centroids, vector &min_distances)
+{
+    uword N = data.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    vector c_norms = RowSquaredNorms(centroids);
+    index_vec labels(N);
+    min_distances.set_size(N);
+
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        Matrix distances = BlockDistances(data, data_norms, r0, r1, centroids, c_norms);
+        for (uword a = 0; a < distances.n_cols; a++) {
+            uword best_k = distances.col(a).index_min();
+            labels(r0 + a) = best_k;
+            min_distances(r0 + a) = distances(best_k, a);
+        }
+    }
+
+    return labels;
+}
+
+/*
+Validates the initial centroids of a k-means engine.
+*/
+static void CheckCentroids(const Matrix &data, const Matrix &init_centroids, const arma::dvec &weights)
+{
+    if ((init_centroids.n_rows == 0) || (data.n_rows == 0) || (init_centroids.n_cols != data.n_cols)) {
+        throw std::invalid_argument("Initial centroids do not match the dataset.\n");
+    }
+    if (!weights.is_empty() && (weights.n_elem != data.n_rows)) {
+        throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+    }
+}
+
+/*
+Lloyd's k-means on the rows of data. See LloydKmeans with data_norms.
+*/
+kmeans_result LloydKmeans(
+    const Matrix &data, const Matrix &init_centroids, uword max_iter,
+    float tolerance, bool print_steps)
+{
+    return LloydKmeans(data, RowSquaredNorms(data), init_centroids, max_iter, tolerance, print_steps);
+}
+
+/*
+Lloyd's k-means on the rows of data, starting from the rows of init_centroids.
+
+Each iteration assigns every sample to its closest centroid (blocked GEMM 
+distances, OpenMP parallel) and moves the centroids to the mean of their 
+samples. Empty clusters keep their previous centroid. The iterations stop when 
+no label changes or the total squared centroid shift is below the tolerance.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+data_norms : vector
+    Squared norm of each sample, see RowSquaredNorms.
+init_centroids : Matrix (n_clusters, n_features)
+    Initial centroids.
+max_iter : uword
+    Maximum number of iterations.
+tolerance : float, optional
+    Relative tolerance on the centroid shift, see ScaledTolerance. Defaults to 1e-4.
+print_steps : bool, optional
+    Print the progress of each iteration. Defaults to false.
+weights : arma::dvec, optional
+    Weight of each sample (e.g. the multiplicity of a deduplicated frame). The
+    centroids are weighted means and the inertia is weighted, so the result 
+    matches the dataset with each sample repeated weights(i) times. 
+    Defaults to empty, every sample counts once.
+
+Returns
+-------
+kmeans_result
+    Labels, centroids, number of iterations run and inertia.
+*/
+kmeans_result LloydKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance, bool print_steps, const arma::dvec &weights)
+{
+    CheckCentroids(data, init_centroids, weights);
+
+    kmeans_result result;
+    uword N = data.n_rows;
+    uword k = init_centroids.n_rows;
+    double abs_tolerance = ScaledTolerance(data, weights, tolerance);
+
+    Matrix centroids = init_centroids;
+    index_vec labels(N);
+    labels.fill(k);
+    vector min_distances(N);
+    vector movement(k);
+    arma::dmat sums;
+    arma::dvec counts;
+    uword n_changed = N;
+    double inertia = 0.0;
+
+    for (uword iter = 0; iter < max_iter; iter++) {
+        inertia = AssignAndAccumulate(data, data_norms, centroids, labels, min_distances, sums, counts, n_changed, weights);
+
+        double shift = UpdateCentroids(centroids, sums, counts, movement);
+        result.n_iter = iter + 1;
+
+        if (print_steps) {
+            printf("Iteration %llu: inertia %.6f, labels changed %llu, centroid shift %.6e\n",
+                   result.n_iter, inertia, n_changed, shift);
+        }
+
+        if ((n_changed == 0) || (shift <= abs_tolerance)) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    // Labels and inertia of the returned centroids, unless nothing moved
+    if ((result.n_iter == 0) || (n_changed != 0)) {
+        inertia = AssignAndAccumulate(data, data_norms, centroids, labels, min_distances, sums, counts, n_changed, weights);
+    }
+
+    result.labels = labels;
+    result.centroids = centroids;
+    result.inertia = inertia;
+
+    return result;
+}
+
+/*
+Hamerly's k-means on the rows of data, starting from the rows of init_centroids.
+
+Every sample keeps an upper bound on the distance to its centroid and a lower
+bound on the distance to the second closest one. After each update the bounds
+are loosened by the centroid movements, and the distances of a sample are only 
+recomputed when its upper bound exceeds both its lower bound and half the 
+distance of its centroid to the closest other centroid. The assignments, and 
+hence the centroids and iterations, are the same as LloydKmeans.
+
+Parameters
+----------
+See LloydKmeans.
+
+Returns
+-------
+kmeans_result
+    Labels, centroids, number of iterations run and inertia.
+*/
+kmeans_result HamerlyKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance, bool print_steps, const arma::dvec &weights)
+{
+    CheckCentroids(data, init_centroids, weights);
+
+    kmeans_result result;
+    uword N = data.n_rows;
+    uword k = init_centroids.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    double abs_tolerance = ScaledTolerance(data, weights, tolerance);
+
+    Matrix centroids = init_centroids;
+    Matrix centroid_distances;
+    index_vec labels(N);
+    vector upper(N);
+    vector lower(N);
+    vector min_distances(N);
+    vector movement(k);
+    vector half_sep(k);
+    arma::dmat sums;
+    arma::dvec counts;
+    uword n_changed = N;
+
+    // Exact bounds with the initial centroids
+    vector c_norms = RowSquaredNorms(centroids);
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        Matrix distances = BlockDistances(data, data_norms, r0, r1, centroids, c_norms);
+        for (uword a = 0; a < distances.n_cols; a++) {
+            float best = INFINITY;
+            float second = INFINITY;
+            uword best_k = 0;
+            for (uword c = 0; c < k; c++) {
+                float d = distances(c, a);
+                if (d < best) {second = best; best = d; best_k = c;}
+                else if (d < second) {second = d;}
+            }
+            labels(r0 + a) = best_k;
+            upper(r0 + a) = std::sqrt(best);
+            lower(r0 + a) = std::sqrt(second);
+        }
+    }
+
+    // Bounded assignment, returns the number of changed labels
+    auto bounded_assign = [&]() -> uword {
+        uword changed = 0;
+        half_sep = HalfSeparation(centroids, centroid_distances);
+
+        #pragma omp parallel reduction(+:changed)
+        {
+            std::vector<double> distances(k);
+
+            #pragma omp for schedule(static)
+            for (uword i = 0; i < N; i++) {
+                uword a = labels(i);
+                float bound = std::max(half_sep(a), lower(i));
+                if (upper(i) <= bound) {continue;}
+
+                upper(i) = PointDistance(data, i, centroids, a);
+                if (upper(i) <= bound) {continue;}
+
+                PointDistances(data, i, centroids, distances);
+                double best = INFINITY;
+                double second = INFINITY;
+                uword best_k = 0;
+                for (uword c = 0; c < k; c++) {
+                    if (distances[c] < best) {second = best; best = distances[c]; best_k = c;}
+                    else if (distances[c] < second) {second = distances[c];}
+                }
+                if (best_k != a) {changed++;}
+                labels(i) = best_k;
+                upper(i) = best;
+                lower(i) = second;
+            }
+        }
+
+        return changed;
+    };
+
+    for (uword iter = 0; iter < max_iter; iter++) {
+        if (iter > 0) {n_changed = bounded_assign();}
+
+        AccumulateSums(data, labels, k, sums, counts, weights);
+        double shift = UpdateCentroids(centroids, sums, counts, movement);
+        result.n_iter = iter + 1;
+
+        // Loosen the bounds by the centroid movements
+        uword max_k = movement.index_max();
+        float max_move = movement(max_k);
+        float second_move = 0;
+        for (uword c = 0; c < k; c++) {
+            if ((c != max_k) && (movement(c) > second_move)) {second_move = movement(c);}
+        }
+        #pragma omp parallel for schedule(static)
+        for (uword i = 0; i < N; i++) {
+            upper(i) += movement(labels(i));
+            lower(i) -= (labels(i) == max_k) ? second_move : max_move;
+        }
+
+        if (print_steps) {
+            printf("Iteration %llu: labels changed %llu, centroid shift %.6e\n",
+                   result.n_iter, n_changed, shift);
+        }
+
+        if ((n_changed == 0) || (shift <= abs_tolerance)) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    // Labels of the returned centroids, unless nothing moved
+    if ((result.n_iter > 0) && (n_changed != 0)) {
+        bounded_assign();
+    }
+
+    result.inertia = LabelInertia(data, centroids, labels, min_distances, weights);
+    result.labels = labels;
+    result.centroids = centroids;
+
+    return result;
+}
+
+/*
+Elkan's k-means on the rows of data, starting from the rows of init_centroids.
+
+Every sample keeps an upper bound on the distance to its centroid and a lower
+bound on the distance to every centroid, and the distance of a sample to a 
+centroid is only recomputed when neither the lower bound nor half the distance
+between the two centroids rules it out. It skips more distances than Hamerly's 
+algorithm for larger numbers of clusters, at the cost of n_samples * n_clusters
+bounds in memory. The assignments are the same as LloydKmeans.
+
+Parameters
+----------
+See LloydKmeans.
+
+Returns
+-------
+kmeans_result
+    Labels, centroids, number of iterations run and inertia.
+*/
+kmeans_result ElkanKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance, bool print_steps, const arma::dvec &weights)
+{
+    CheckCentroids(data, init_centroids, weights);
+
+    kmeans_result result;
+    uword N = data.n_rows;
+    uword k = init_centroids.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    double abs_tolerance = ScaledTolerance(data, weights, tolerance);
+
+    Matrix centroids = init_centroids;
+    Matrix centroid_distances;
+    index_vec labels(N);
+    vector upper(N);
+    // Lower bounds (n_clusters, n_samples), the bounds of a sample are contiguous
+    Matrix lower(k, N);
+    vector min_distances(N);
+    vector movement(k);
+    vector half_sep(k);
+    arma::dmat sums;
+    arma::dvec counts;
+    uword n_changed = N;
+
+    // Exact bounds with the initial centroids
+    vector c_norms = RowSquaredNorms(centroids);
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        Matrix distances = arma::sqrt(BlockDistances(data, data_norms, r0, r1, centroids, c_norms));
+        lower.cols(r0, r1) = distances;
+        for (uword a = 0; a < distances.n_cols; a++) {
+            uword best_k = distances.col(a).index_min();
+            labels(r0 + a) = best_k;
+            upper(r0 + a) = distances(best_k, a);
+        }
+    }
+
+    // Bounded assignment, returns the number of changed labels
+    auto bounded_assign = [&]() -> uword {
+        uword changed = 0;
+        half_sep = HalfSeparation(centroids, centroid_distances);
+
+        #pragma omp parallel for schedule(static) reduction(+:changed)
+        for (uword i = 0; i < N; i++) {
+            uword a = labels(i);
+            float u = upper(i);
+            if (u <= half_sep(a)) {continue;}
+
+            float *lower_i = lower.colptr(i);
+            bool tight = false;
+            for (uword c = 0; c < k; c++) {
+                if ((c == a) || (u <= lower_i[c]) || (u <= 0.5 * centroid_distances(c, a))) {continue;}
+
+                if (!tight) {
+                    u = PointDistance(data, i, centroids, a);
+                    lower_i[a] = u;
+                    tight = true;
+                    if ((u <= lower_i[c]) || (u <= 0.5 * centroid_distances(c, a))) {continue;}
+                }
+
+                float d = PointDistance(data, i, centroids, c);
+                lower_i[c] = d;
+                if (d < u) {
+                    a = c;
+                    u = d;
+                }
+            }
+
+            if (a != labels(i)) {changed++;}
+            labels(i) = a;
+            upper(i) = u;
+        }
+
+        return changed;
+    };
+
+    for (uword iter = 0; iter < max_iter; iter++) {
+        if (iter > 0) {n_changed = bounded_assign();}
+
+        AccumulateSums(data, labels, k, sums, counts, weights);
+        double shift = UpdateCentroids(centroids, sums, counts, movement);
+        result.n_iter = iter + 1;
+
+        // Loosen the bounds by the centroid movements
+        #pragma omp parallel for schedule(static)
+        for (uword i = 0; i < N; i++) {
+            float *lower_i = lower.colptr(i);
+            for (uword c = 0; c < k; c++) {
+                lower_i[c] = std::max(lower_i[c] - movement(c), 0.0f);
+            }
+            upper(i) += movement(labels(i));
+        }
+
+        if (print_steps) {
+            printf("Iteration %llu: labels changed %llu, centroid shift %.6e\n",
+                   result.n_iter, n_changed, shift);
+        }
+
+        if ((n_changed == 0) || (shift <= abs_tolerance)) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    // Labels of the returned centroids, unless nothing moved
+    if ((result.n_iter > 0) && (n_changed != 0)) {
+        bounded_assign();
+    }
+
+    result.inertia = LabelInertia(data, centroids, labels, min_distances, weights);
+    result.labels = labels;
+    result.centroids = centroids;
+
+    return result;
+}
+
+/*
+Runs the k-means engine of the given algorithm.
+
+Parameters
+----------
+algorithm : Algorithm enum {LLOYD, HAMERLY, ELKAN}
+    K-means algorithm, all of them give the same assignments.
+See LloydKmeans for the remaining parameters.
+
+Returns
+-------
+kmeans_result
+    Labels, centroids, number of iterations run and inertia.
+*/
+kmeans_result RunKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance, Algorithm algorithm, bool print_steps,
+    const arma::dvec &weights)
+{
+    switch (algorithm)
+    {
+    case Algorithm::HAMERLY:
+        return HamerlyKmeans(data, data_norms, init_centroids, max_iter, tolerance, print_steps, weights);
+    case Algorithm::ELKAN:
+        return ElkanKmeans(data, data_norms, init_centroids, max_iter, tolerance, print_steps, weights);
+    case Algorithm::LLOYD:
+    default:
+        return LloydKmeans(data, data_norms, init_centroids, max_iter, tolerance, print_steps, weights);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef KMEANS_ENGINE_H
+#define KMEANS_ENGINE_H
+#include "../../Datatypes/DataContainers.h"
+#include "../../Datatypes/Distances.h"
+
+// Number of rows in a distance block of the k-means engines
+#define KMEANS_BLOCK_SIZE 1024
+
+// OpenBLAS threads (linked with -lopenblas), set to one while concurrent runs share the OpenMP threads
+extern "C" {
+    int openblas_get_num_threads(void);
+    void openblas_set_num_threads(int num_threads);
+}
+
+// K-means algorithms, all converge to the same result as Lloyd's.
+// 'LLOYD' computes every sample-centroid distance each iteration.
+// 'HAMERLY' keeps one upper and one lower bound per sample to skip most distances.
+// 'ELKAN' keeps one lower bound per sample and centroid (n_samples * n_clusters memory).
+enum class Algorithm { LLOYD = 0, HAMERLY, ELKAN };
+
+std::string toStr(Algorithm);
+
+// Result of a k-means engine run
+struct kmeans_result
+{
+    kmeans_result() {
+        labels = index_vec();
+        centroids = Matrix();
+        n_iter = 0;
+        inertia = 0.0;
+        converged = false;
+    }
+    // Label of each sample
+    index_vec labels;
+    // Centroids (n_clusters, n_features)
+    Matrix centroids;
+    // Number of iterations run
+    uword n_iter;
+    // Sum of squared distances of the samples to their closest centroid
+    double inertia;
+    // Whether the tolerance was reached before the maximum number of iterations
+    bool converged;
+};
+
+// Squared euclidean norm of each row of the matrix
+vector RowSquaredNorms(const Matrix &data);
+
+// Converts a relative tolerance to an absolute one using the mean feature variance
+double ScaledTolerance(const Matrix &data, float tolerance);
+
+// Scaled tolerance of a dataset whose samples count weights(i) times
+double ScaledTolerance(const Matrix &data, const arma::dvec &weights, float tolerance);
+
+// Squared distances (n_clusters, r1 - r0 + 1) of the rows r0 to r1 of data to every centroid
+Matrix BlockDistances(const Matrix &data, const vector &data_norms, uword r0, uword r1,
+                      const Matrix &centroids, const vector &c_norms);
+
+// Closest centroid of each row of data, blocked and parallel
+index_vec AssignLabels(const Matrix &data, const vector &data_norms, const Matrix &centroids, vector &min_distances);
+
+// Lloyd's k-means on the rows of data, starting from the rows of init_centroids
+kmeans_result LloydKmeans(
+    const Matrix &data, const Matrix &init_centroids, uword max_iter,
+    float tolerance = 1e-4, bool print_steps = false);
+
+// Lloyd's k-means with precomputed squared row norms of data, samples count weights(i) times if given
+kmeans_result LloydKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance = 1e-4, bool print_steps = false,
+    const arma::dvec &weights = arma::dvec());
+
+// Hamerly's k-means, skips distance computations using per-sample bounds
+kmeans_result HamerlyKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance = 1e-4, bool print_steps = false,
+    const arma::dvec &weights = arma::dvec());
+
+// Elkan's k-means, skips distance computations using per-sample and per-centroid bounds
+kmeans_result ElkanKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance = 1e-4, bool print_steps = false,
+    const arma::dvec &weights = arma::dvec());
+
+// Runs the k-means engine of the given algorithm
+kmeans_result RunKmeans(
+    const Matrix &data, const vector &data_norms, const Matrix &init_centroids,
+    uword max_iter, float tolerance = 1e-4, Algorithm algorithm = Algorithm::LLOYD,
+    bool print_steps = false, const arma::dvec &weights = arma::dvec());
+
+#endif // !KMEANS_ENGINE_H
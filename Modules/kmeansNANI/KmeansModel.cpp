@@ -0,0 +1,588 @@
+#include "KmeansModel.h"
+#include <fstream>
+#include <future>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Labels are stored as 64 bit integers and used in place
+static_assert(sizeof(uword) == sizeof(uint64_t), "The model format needs 64 bit armadillo words.");
+
+// Alignment of the arrays in the model files
+#define MODEL_ALIGNMENT 64
+
+// Offset basis of the 64 bit FNV-1a data hash
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+
+// Layout of a model file: this header, then the arrays at the given offsets,
+// each aligned to MODEL_ALIGNMENT bytes and stored column-major
+struct KmeansModel::file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t has_stats;
+    uint64_t n_clusters;
+    uint64_t n_features;
+    uint64_t n_labels;
+    int32_t initiator;
+    int32_t metric;
+    int32_t n_atoms;
+    int32_t reserved;
+    uint64_t n_iter;
+    double inertia;
+    float ch;
+    float db;
+    float sil;
+    float padding;
+    uint64_t data_hash;
+    // centroids (float), centroid norms (float), labels (uint64), counts, sums, squared sums (double)
+    uint64_t offsets[6];
+    uint64_t file_size;
+};
+
+static const char MODEL_MAGIC[8] = {'N', 'A', 'M', 'I', 'K', 'M', 'D', 'L'};
+
+/*
+Constructor of the KmeansModel class.
+
+Parameters
+----------
+centroids : 2D Matrix (n_clusters, n_features)
+    Fitted centroids.
+*/
+KmeansModel::KmeansModel(const Matrix &centroids)
+{
+    if (centroids.is_empty()) {
+        throw std::invalid_argument("The model needs at least one centroid.\n");
+    }
+    this->m_centroids = centroids;
+    this->m_c_norms = RowSquaredNorms(centroids);
+}
+
+/*
+Constructor of the KmeansModel class from the result of a clustering.
+
+Parameters
+----------
+data : cluster_data
+    Result of KmeansNANI, the centers are (n_features, n_clusters). The 
+    labels and cluster statistics are kept.
+info : model_info, optional
+    Parameters and scores of the fit.
+*/
+KmeansModel::KmeansModel(const cluster_data &data, const model_info &info) : KmeansModel(Matrix(data.centers.t()))
+{
+    this->info = info;
+    if (this->info.n_iter == 0) {this->info.n_iter = data.n_iter;}
+    if (this->info.inertia == 0) {this->info.inertia = data.inertia;}
+    this->m_labels = data.labels;
+    this->m_stats = data.stats;
+}
+
+/*
+Model on the arrays of a memory mapped model file, the matrices use the 
+mapped memory without copies (see KmeansModel::Load). They are not strict,
+resizing one (e.g. KmeansModel::Update) moves it to its own memory.
+*/
+KmeansModel::KmeansModel(const std::shared_ptr<char> &mapping, const file_header &header)
+    : m_mapping(mapping),
+      m_centroids((float*)(mapping.get() + header.offsets[0]), header.n_clusters, header.n_features, false, false),
+      m_c_norms((float*)(mapping.get() + header.offsets[1]), header.n_clusters, false, false),
+      m_labels((uword*)(mapping.get() + header.offsets[2]), header.n_labels, false, false),
+      m_stats{arma::dvec((double*)(mapping.get() + header.offsets[3]), header.has_stats ? header.n_clusters : 0, false, false),
+              arma::dmat((double*)(mapping.get() + header.offsets[4]), header.has_stats ? header.n_clusters : 0,
+                         header.has_stats ? header.n_features : 0, false, false),
+              arma::dmat((double*)(mapping.get() + header.offsets[5]), header.has_stats ? header.n_clusters : 0,
+                         header.has_stats ? header.n_features : 0, false, false)}
+{
+    this->info.initiator = (Initiator)header.initiator;
+    this->info.metric = (Metric)header.metric;
+    this->info.n_atoms = header.n_atoms;
+    this->info.n_iter = header.n_iter;
+    this->info.inertia = header.inertia;
+    this->info.fit_scores = scores(header.ch, header.db, header.sil);
+    this->info.data_hash = header.data_hash;
+}
+
+// 64 bit FNV-1a of a byte range, continued from hash
+static uint64_t FNV1a(uint64_t hash, const unsigned char *bytes, size_t n_bytes)
+{
+    const uint64_t prime = 1099511628211ULL;
+    for (size_t i = 0; i < n_bytes; i++) {
+        hash ^= bytes[i];
+        hash *= prime;
+    }
+    return hash;
+}
+
+/*
+Continues the FNV-1a hash of each column over rows first to last - 1, in 
+parallel over the columns. Empty column hashes are started from the offset
+basis, so hashing rows [0, n) then [n, N) gives the hashes of rows [0, N).
+*/
+static void ExtendColumnHashes(const Matrix &data, uword first, uword last, std::vector<uint64_t> &column_hashes)
+{
+    if (column_hashes.empty()) {column_hashes.assign(data.n_cols, FNV_OFFSET_BASIS);}
+
+    #pragma omp parallel for schedule(static)
+    for (uword j = 0; j < data.n_cols; j++) {
+        column_hashes[j] = FNV1a(column_hashes[j], (const unsigned char*)(data.colptr(j) + first),
+                                 (last - first) * sizeof(float));
+    }
+}
+
+// Hash of the shape followed by the column hashes in order
+static uint64_t CombineColumnHashes(uword n_rows, uword n_cols, const std::vector<uint64_t> &column_hashes)
+{
+    uint64_t shape[2] = {n_rows, n_cols};
+    uint64_t hash = FNV1a(FNV_OFFSET_BASIS, (const unsigned char*)shape, sizeof(shape));
+    return FNV1a(hash, (const unsigned char*)column_hashes.data(), column_hashes.size() * sizeof(uint64_t));
+}
+
+/*
+Hash of a dataset, to check that a model belongs to the data it is used with.
+Each column is hashed with 64 bit FNV-1a in parallel, then the shape and the
+column hashes are hashed in order.
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Dataset.
+
+Returns
+-------
+unsigned long long
+    Hash of the dataset.
+*/
+unsigned long long DataHash(const Matrix &data)
+{
+    return DataHash(data, data.n_rows);
+}
+
+/*
+Hash of the first n_rows of a dataset, see DataHash. The leading rows of 
+each column are hashed in place, so the hash of a fitted prefix of a grown
+trajectory needs no copy.
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Dataset.
+n_rows : uword
+    Number of leading rows to hash, at most n_samples.
+
+Returns
+-------
+unsigned long long
+    Hash of data.rows(0, n_rows - 1).
+*/
+unsigned long long DataHash(const Matrix &data, uword n_rows)
+{
+    if (n_rows > data.n_rows) {
+        throw std::length_error("The number of rows to hash is larger than the number of samples.\n");
+    }
+
+    std::vector<uint64_t> column_hashes;
+    ExtendColumnHashes(data, 0, n_rows, column_hashes);
+    return CombineColumnHashes(n_rows, data.n_cols, column_hashes);
+}
+
+/*
+Writes the model to a binary file: a fixed header (version, shapes, fit 
+parameters, scores and data hash) followed by the centroids, centroid norms,
+labels and cluster statistics as raw arrays aligned to MODEL_ALIGNMENT bytes,
+so KmeansModel::Load can map them without parsing.
+
+Parameters
+----------
+filename : std::string
+    Output file, overwritten.
+*/
+void KmeansModel::Save(const std::string &filename) const
+{
+    bool has_stats = (this->m_stats.n_clusters() == this->n_clusters()) && (this->m_stats.sums.n_cols == this->n_features());
+
+    file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header.version = KMEANS_MODEL_VERSION;
+    header.has_stats = has_stats;
+    header.n_clusters = this->n_clusters();
+    header.n_features = this->n_features();
+    header.n_labels = this->m_labels.n_elem;
+    header.initiator = (int32_t)this->info.initiator;
+    header.metric = (int32_t)this->info.metric;
+    header.n_atoms = this->info.n_atoms;
+    header.n_iter = this->info.n_iter;
+    header.inertia = this->info.inertia;
+    header.ch = this->info.fit_scores.ch;
+    header.db = this->info.fit_scores.db;
+    header.sil = this->info.fit_scores.sil;
+    header.data_hash = this->info.data_hash;
+
+    uint64_t k = header.n_clusters;
+    uint64_t M = header.n_features;
+    uint64_t section_bytes[6] = {k * M * sizeof(float), k * sizeof(float), header.n_labels * sizeof(uint64_t),
+                                 has_stats ? k * sizeof(double) : 0, has_stats ? k * M * sizeof(double) : 0,
+                                 has_stats ? k * M * sizeof(double) : 0};
+    const char *sections[6] = {(const char*)this->m_centroids.memptr(), (const char*)this->m_c_norms.memptr(),
+                               (const char*)this->m_labels.memptr(), (const char*)this->m_stats.counts.memptr(),
+                               (const char*)this->m_stats.sums.memptr(), (const char*)this->m_stats.sq_sums.memptr()};
+
+    uint64_t position = sizeof(file_header);
+    for (int s = 0; s < 6; s++) {
+        position = (position + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+        header.offsets[s] = position;
+        position += section_bytes[s];
+    }
+    header.file_size = position;
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Unable to open " + filename + " for writing.\n");
+    }
+
+    out.write((const char*)&header, sizeof(header));
+    uint64_t written = sizeof(header);
+    const char zeros[MODEL_ALIGNMENT] = {0};
+    for (int s = 0; s < 6; s++) {
+        out.write(zeros, header.offsets[s] - written);
+        if (section_bytes[s] > 0) {out.write(sections[s], section_bytes[s]);}
+        written = header.offsets[s] + section_bytes[s];
+    }
+
+    if (!out.good()) {
+        std::fprintf(stderr, "Failed to save model to file!\n");
+    }
+}
+
+/*
+Loads a model file written by KmeansModel::Save by memory mapping it. The 
+centroids, labels and cluster statistics point into the (private, copy on 
+write) mapping, so loading costs no parsing or copies whatever the number of
+labels; pages are read on first access. The mapping lives as long as the 
+model (copies of the model own copies of the arrays).
+
+Parameters
+----------
+filename : std::string
+    Model file.
+
+Returns
+-------
+KmeansModel
+    Model of the file.
+*/
+KmeansModel KmeansModel::Load(const std::string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open " + filename + ".\n");
+    }
+
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || ((size_t)file_stat.st_size < sizeof(file_header))) {
+        close(fd);
+        throw std::runtime_error(filename + " is not a k-means model file.\n");
+    }
+
+    size_t size = file_stat.st_size;
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Unable to map " + filename + ".\n");
+    }
+    std::shared_ptr<char> mapping((char*)address, [size](char *p) {munmap(p, size);});
+
+    file_header header;
+    std::memcpy(&header, mapping.get(), sizeof(header));
+
+    if (std::memcmp(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0) {
+        throw std::runtime_error(filename + " is not a k-means model file.\n");
+    }
+    if (header.version != KMEANS_MODEL_VERSION) {
+        throw std::runtime_error(filename + " has model version " + std::to_string(header.version) +
+                                 ", expected " + std::to_string(KMEANS_MODEL_VERSION) + ".\n");
+    }
+    if ((header.file_size != size) || (header.n_clusters == 0) || (header.n_features == 0)) {
+        throw std::runtime_error(filename + " is truncated or corrupted.\n");
+    }
+    uint64_t k = header.n_clusters;
+    uint64_t M = header.n_features;
+    uint64_t section_bytes[6] = {k * M * sizeof(float), k * sizeof(float), header.n_labels * sizeof(uint64_t),
+                                 header.has_stats ? k * sizeof(double) : 0, header.has_stats ? k * M * sizeof(double) : 0,
+                                 header.has_stats ? k * M * sizeof(double) : 0};
+    for (int s = 0; s < 6; s++) {
+        if ((header.offsets[s] % MODEL_ALIGNMENT != 0) || (header.offsets[s] + section_bytes[s] > size)) {
+            throw std::runtime_error(filename + " is truncated or corrupted.\n");
+        }
+    }
+
+    return KmeansModel(mapping, header);
+}
+
+/*
+Labels the rows of an in-memory matrix with their closest centroid, by blocks
+of rows in parallel (see AssignLabels).
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Frames to label.
+min_distances : vector
+    Output, squared distance of each frame to its closest centroid.
+
+Returns
+-------
+index_vec
+    Label of each frame.
+*/
+index_vec KmeansModel::Predict(const Matrix &data, vector &min_distances) const
+{
+    if (data.n_cols != this->n_features()) {
+        throw std::invalid_argument("The number of features does not match the model.\n");
+    }
+    return AssignLabels(data, RowSquaredNorms(data), this->m_centroids, min_distances);
+}
+
+index_vec KmeansModel::Predict(const Matrix &data) const
+{
+    vector min_distances;
+    return this->Predict(data, min_distances);
+}
+
+/*
+Labels every row of a chunk source, e.g. an NPYChunkReader on a trajectory 
+that is still growing, without loading it. Rows are read chunk_size at a 
+time and the read of the next chunk runs in a background thread while the 
+current chunk is labelled, so at most two chunks are held in memory. The 
+reads stay sequential, sources that are not thread safe can be used.
+
+Parameters
+----------
+source : ChunkSource
+    Frames to label (n_samples, n_features).
+sink : label_sink
+    Called once per chunk, in order, with the index of the first row of the 
+    chunk and the labels of its rows.
+chunk_size : uword, optional
+    Number of rows per chunk. Defaults to STREAM_CHUNK_SIZE.
+
+Returns
+-------
+predict_stats
+    Number of frames, inertia and wall time (frames per second with fps()).
+*/
+predict_stats KmeansModel::Predict(const ChunkSource &source, const label_sink &sink, uword chunk_size) const
+{
+    if (source.n_cols() != this->n_features()) {
+        throw std::invalid_argument("The number of features does not match the model.\n");
+    }
+
+    uword N = source.n_rows();
+    if (chunk_size == 0) {chunk_size = STREAM_CHUNK_SIZE;}
+
+    predict_stats stats;
+    double start = omp_get_wtime();
+
+    auto read_chunk = [&source, N, chunk_size](uword first) {
+        return source.ReadRows(first, std::min(first + chunk_size, N) - 1);
+    };
+
+    std::future<Matrix> next;
+    if (N > 0) {next = std::async(std::launch::async, read_chunk, 0);}
+
+    for (uword first = 0; first < N; first += chunk_size) {
+        Matrix chunk = next.get();
+        if (first + chunk_size < N) {
+            next = std::async(std::launch::async, read_chunk, first + chunk_size);
+        }
+
+        vector min_distances;
+        index_vec labels = this->Predict(chunk, min_distances);
+        stats.inertia += arma::accu(arma::conv_to<arma::dvec>::from(min_distances));
+        stats.n_frames += labels.n_elem;
+
+        sink(first, labels);
+    }
+
+    stats.seconds = omp_get_wtime() - start;
+
+    return stats;
+}
+
+/*
+Streams the labels of every row of a chunk source to a text file, one label 
+per line in row order, flushed after every chunk. See KmeansModel::Predict 
+with a label_sink.
+
+Parameters
+----------
+source : ChunkSource
+    Frames to label (n_samples, n_features).
+labels_file : std::string
+    Output file, overwritten.
+chunk_size : uword, optional
+    Number of rows per chunk. Defaults to STREAM_CHUNK_SIZE.
+
+Returns
+-------
+predict_stats
+    Number of frames, inertia and wall time (frames per second with fps()).
+*/
+predict_stats KmeansModel::Predict(const ChunkSource &source, const std::string &labels_file, uword chunk_size) const
+{
+    std::ofstream out(labels_file);
+    if (!out.is_open()) {
+        throw std::runtime_error("Unable to open " + labels_file + " for writing.\n");
+    }
+
+    predict_stats stats = this->Predict(source,
+        [&out](uword first, const index_vec &labels) {
+            std::string text;
+            for (uword i = 0; i < labels.n_elem; i++) {
+                text += std::to_string(labels(i));
+                text += '\n';
+            }
+            out << text;
+            out.flush();
+        }, chunk_size);
+
+    if (!out.good()) {
+        std::fprintf(stderr, "Failed to save labels to file!\n");
+    }
+
+    return stats;
+}
+
+/*
+Incremental update of the model for a trajectory that has grown since the 
+fit. The rows of data past the fitted labels are the new frames:
+
+1. When the model records the hash of its fitted data, the first rows of 
+   data must hash to it (one pass over the fitted rows, without the k 
+   factor of an assignment). The new frames are labelled with the current 
+   centroids and their cluster statistics are computed.
+2. The drift is the relative increase of the mean squared distance of the 
+   new frames to their closest centroid over the mean of the fit 
+   (info.inertia / n_fitted), i.e. how much worse the model fits the new 
+   frames. Above drift_threshold the model is fitted again on the whole 
+   data with the initiator of the fit (KmeansNANI).
+3. Otherwise the statistics are merged and the centroids moved to the means
+   of all the frames of their cluster. The optional n_warm_iter Lloyd 
+   iterations run on the whole data from these centroids, at O(n_samples 
+   n_clusters n_features) each, so by default the update only costs the
+   new frames.
+
+The column hashes of the checked fitted rows are extended over the new frames
+for the hash of data, the fitted rows are not hashed twice. A model without 
+a data hash keeps none.
+
+The fit scores are cleared, see ComputeDataScores to recompute them.
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Whole trajectory, its first rows must be the frames of the fitted labels
+    (checked against info.data_hash when it is set).
+n_warm_iter : uword, optional
+    Number of warm-started Lloyd iterations on the whole data. Defaults to 0.
+drift_threshold : float, optional
+    Relative increase of the mean squared distance that triggers a full 
+    re-initiation. Defaults to 0.5.
+max_iter : uword, optional
+    Maximum number of iterations of a full re-initiation. Defaults to 100.
+
+Returns
+-------
+update_result
+    Number of new frames, drift, whether the model was fitted again, 
+    iterations run and inertia.
+*/
+update_result KmeansModel::Update(const Matrix &data, uword n_warm_iter, float drift_threshold, uword max_iter)
+{
+    uword N = data.n_rows;
+    uword n_old = this->m_labels.n_elem;
+    uword k = this->n_clusters();
+
+    if (data.n_cols != this->n_features()) {
+        throw std::invalid_argument("The number of features does not match the model.\n");
+    }
+    if ((n_old == 0) || (this->m_stats.n_clusters() != k)) {
+        throw std::invalid_argument("The model has no labels or cluster statistics to update.\n");
+    }
+    if (N < n_old) {
+        throw std::length_error("The data has fewer frames than the fitted labels.\n");
+    }
+
+    std::vector<uint64_t> column_hashes;
+    bool has_hash = (this->info.data_hash != 0);
+    if (has_hash) {
+        ExtendColumnHashes(data, 0, n_old, column_hashes);
+        if (CombineColumnHashes(n_old, data.n_cols, column_hashes) != this->info.data_hash) {
+            throw std::invalid_argument("The first frames of the data do not match the fitted data.\n");
+        }
+    }
+
+    update_result result;
+    result.n_new = N - n_old;
+    result.inertia = this->info.inertia;
+    if (result.n_new == 0) {return result;}
+
+    // Assign only the new frames
+    Matrix new_frames = data.rows(n_old, N - 1);
+    vector min_distances;
+    index_vec new_labels = this->Predict(new_frames, min_distances);
+    cluster_stats new_stats = ClusterStatistics(new_frames, new_labels, k);
+
+    // Fit of the new frames against the fit of the fitted frames, a short block of frames has the same scale
+    double old_mean = this->info.inertia / n_old;
+    double new_mean = arma::accu(arma::conv_to<arma::dvec>::from(min_distances)) / result.n_new;
+    result.drift = (old_mean > 0) ? (float)std::max(new_mean / old_mean - 1.0, 0.0) : 0.0f;
+
+    if (result.drift > drift_threshold) {
+        KmeansNANI mod(data, k, this->info.metric, this->info.n_atoms, this->info.initiator, max_iter);
+        cluster_data fit = mod.KmeansClustering();
+
+        this->m_centroids = fit.centers.t();
+        this->m_labels = fit.labels;
+        this->m_stats = fit.stats;
+        this->info.n_iter = fit.n_iter;
+        this->info.inertia = fit.inertia;
+        result.reinitialized = true;
+        result.n_iter = fit.n_iter;
+    } else {
+        // Merged statistics, the centroids are the means of all the frames of their cluster
+        this->m_stats.counts += new_stats.counts;
+        this->m_stats.sums += new_stats.sums;
+        this->m_stats.sq_sums += new_stats.sq_sums;
+        this->m_labels = arma::join_cols(this->m_labels, new_labels);
+        for (uword c = 0; c < k; c++) {
+            if (this->m_stats.counts(c) > 0) {
+                this->m_centroids.row(c) = arma::conv_to<rvector>::from(this->m_stats.sums.row(c) / this->m_stats.counts(c));
+            }
+        }
+        this->info.inertia = arma::accu(ClusterWCSS(this->m_stats));
+
+        if (n_warm_iter > 0) {
+            kmeans_result warm = RunKmeans(data, RowSquaredNorms(data), this->m_centroids, n_warm_iter);
+            this->m_centroids = warm.centroids;
+            this->m_labels = warm.labels;
+            this->m_stats = ClusterStatistics(data, warm.labels, k);
+            this->info.inertia = warm.inertia;
+            result.n_iter = warm.n_iter;
+        }
+    }
+
+    this->m_c_norms = RowSquaredNorms(this->m_centroids);
+    if (has_hash) {
+        ExtendColumnHashes(data, n_old, N, column_hashes);
+        this->info.data_hash = CombineColumnHashes(N, data.n_cols, column_hashes);
+    }
+    this->info.fit_scores = scores();
+    result.inertia = this->info.inertia;
+
+    return result;
+}
@@ -0,0 +1,153 @@
+#ifndef KMEANS_MODEL_H
+#define KMEANS_MODEL_H
+#include <memory>
+#include <string>
+#include "../../Datatypes/DataContainers.h"
+#include "KmeansEngine.h"
+#include "MiniBatch.h"
+#include "nani.h"
+
+// Summary of a streaming prediction pass
+struct predict_stats
+{
+    predict_stats() {
+        n_frames = 0;
+        inertia = 0.0;
+        seconds = 0.0;
+    }
+    uword n_frames;
+    // Sum of squared distances of the frames to their closest centroid
+    double inertia;
+    // Wall time of the pass, reads included
+    double seconds;
+
+    // Throughput in frames per second
+    double fps() const {return (seconds > 0) ? n_frames / seconds : 0.0;}
+};
+
+// Summary of an incremental update of a model
+struct update_result
+{
+    update_result() {
+        n_new = 0;
+        drift = 0.0;
+        reinitialized = false;
+        n_iter = 0;
+        inertia = 0.0;
+    }
+    // Number of appended frames
+    uword n_new;
+    // Relative increase of the mean squared distance to the closest centroid of the appended frames over the fit
+    float drift;
+    // Whether the drift exceeded the threshold and the model was fitted again from scratch
+    bool reinitialized;
+    // Number of warm-started (or full) k-means iterations run
+    uword n_iter;
+    // Inertia of the updated model
+    double inertia;
+};
+
+// Version of the binary model files written by KmeansModel::Save
+#define KMEANS_MODEL_VERSION 1
+
+// Parameters and scores of the fit that produced a model
+struct model_info
+{
+    model_info() {
+        initiator = Initiator::COMP_SIM;
+        metric = Metric::MSD;
+        n_atoms = 1;
+        n_iter = 0;
+        inertia = 0.0;
+        data_hash = 0;
+    }
+    Initiator initiator;
+    Metric metric;
+    int n_atoms;
+    uword n_iter;
+    double inertia;
+    scores fit_scores;
+    // Hash of the fitted dataset, see DataHash
+    unsigned long long data_hash;
+};
+
+// FNV-1a hash of the shape and values of a dataset
+unsigned long long DataHash(const Matrix &data);
+
+// Hash of the first n_rows of a dataset, equal to DataHash of data.rows(0, n_rows - 1) without the copy
+unsigned long long DataHash(const Matrix &data, uword n_rows);
+
+/*
+Fitted k-means centroids used to label new frames.
+
+Attributes
+----------
+info : model_info
+    Parameters and scores of the fit.
+m_centroids : 2D matrix (n_clusters, n_features)
+    Centroids of the model.
+m_c_norms : vector (n_clusters)
+    Squared norm of each centroid.
+m_labels : index_vec
+    Labels of the fitted samples (may be empty).
+m_stats : cluster_stats
+    Statistics of the fitted clusters (may be empty).
+m_mapping : std::shared_ptr
+    Memory map of the model file the matrices point into (Load only).
+*/
+class KmeansModel
+{
+public:
+    KmeansModel(const Matrix &centroids);
+
+    // Model of a clustering, centers are (n_features, n_clusters)
+    KmeansModel(const cluster_data &data, const model_info &info = model_info());
+
+    // Writes the model to a versioned binary file
+    void Save(const std::string &filename) const;
+
+    // Memory maps a model file written by Save, the arrays are used in place
+    static KmeansModel Load(const std::string &filename);
+
+    // Labels the frames appended to the fitted data and updates the model, refitting on drift
+    update_result Update(const Matrix &data, uword n_warm_iter = 0, float drift_threshold = 0.5,
+                         uword max_iter = 100);
+
+    uword n_clusters() const {return this->m_centroids.n_rows;}
+
+    uword n_features() const {return this->m_centroids.n_cols;}
+
+    const Matrix &Centroids() const {return this->m_centroids;}
+
+    const vector &CentroidNorms() const {return this->m_c_norms;}
+
+    const index_vec &Labels() const {return this->m_labels;}
+
+    const cluster_stats &Stats() const {return this->m_stats;}
+
+    // Closest centroid of each row of an in-memory matrix
+    index_vec Predict(const Matrix &data, vector &min_distances) const;
+    index_vec Predict(const Matrix &data) const;
+
+    // Streams the rows of source by chunks, the next chunk is read while the current one is labelled
+    predict_stats Predict(const ChunkSource &source, const label_sink &sink,
+                          uword chunk_size = STREAM_CHUNK_SIZE) const;
+
+    // Streams the labels of every row of source to a text file, one label per line
+    predict_stats Predict(const ChunkSource &source, const std::string &labels_file,
+                          uword chunk_size = STREAM_CHUNK_SIZE) const;
+
+    model_info info;
+private:
+    struct file_header;
+
+    KmeansModel(const std::shared_ptr<char> &mapping, const file_header &header);
+
+    std::shared_ptr<char> m_mapping;
+    Matrix m_centroids;
+    vector m_c_norms;
+    index_vec m_labels;
+    cluster_stats m_stats;
+};
+
+#endif // !KMEANS_MODEL_H
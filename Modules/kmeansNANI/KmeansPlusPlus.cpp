@@ -0,0 +1,340 @@
+#include "KmeansPlusPlus.h"
+
+/*
+Lowers the squared distance of every row to its closest center with a new set
+of centers, block by block in parallel.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+data_norms : vector
+    Squared norm of each sample.
+centers : Matrix (n_centers, n_features)
+    New centers.
+closest : vector
+    Squared distance of each sample to its closest center, updated in place.
+owner : index_vec
+    Index of the closest center of each sample, updated in place with 
+    offset + the row of centers. Ignored when empty.
+offset : uword
+    Index of the first new center.
+*/
+static void UpdateClosest(const Matrix &data, const vector &data_norms, const Matrix &centers,
+                          vector &closest, index_vec &owner, uword offset)
+{
+    uword N = data.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    vector c_norms = RowSquaredNorms(centers);
+    bool track_owner = !owner.is_empty();
+
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        Matrix distances = BlockDistances(data, data_norms, r0, r1, centers, c_norms);
+        for (uword a = 0; a < distances.n_cols; a++) {
+            uword c = distances.col(a).index_min();
+            if (distances(c, a) < closest(r0 + a)) {
+                closest(r0 + a) = distances(c, a);
+                if (track_owner) {owner(r0 + a) = offset + c;}
+            }
+        }
+    }
+}
+
+/*
+Weighted potential sum(w * min(closest, d^2)) obtained by adding each trial 
+center on its own. Threads accumulate per block and are merged in order.
+
+Returns
+-------
+arma::dvec
+    Potential of each trial.
+*/
+static arma::dvec TrialPotentials(const Matrix &data, const vector &data_norms, const arma::dvec &weights,
+                                  const vector &closest, const Matrix &trials)
+{
+    uword N = data.n_rows;
+    uword n_trials = trials.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    vector t_norms = RowSquaredNorms(trials);
+
+    int n_threads = omp_get_max_threads();
+    std::vector<arma::dvec> t_potentials(n_threads, arma::dvec(n_trials, arma::fill::zeros));
+
+    #pragma omp parallel num_threads(n_threads)
+    {
+        arma::dvec &potentials_t = t_potentials[omp_get_thread_num()];
+
+        #pragma omp for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+            Matrix distances = BlockDistances(data, data_norms, r0, r1, trials, t_norms);
+            for (uword a = 0; a < distances.n_cols; a++) {
+                for (uword t = 0; t < n_trials; t++) {
+                    potentials_t(t) += weights(r0 + a) * std::min(closest(r0 + a), distances(t, a));
+                }
+            }
+        }
+    }
+
+    arma::dvec potentials(n_trials, arma::fill::zeros);
+    for (int t = 0; t < n_threads; t++) {potentials += t_potentials[t];}
+
+    return potentials;
+}
+
+/*
+Draws rows with probability proportional to values (D^2 sampling). Block 
+totals are computed in parallel, so each draw only scans the block totals and
+a single block.
+
+Parameters
+----------
+values : arma::dvec
+    Non-negative value of each row.
+n_draws : uword
+    Number of draws (with replacement).
+
+Returns
+-------
+index_vec
+    Drawn rows, in the order drawn.
+*/
+static index_vec SampleProportional(const arma::dvec &values, uword n_draws)
+{
+    uword N = values.n_elem;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+    arma::dvec block_sums(n_blocks);
+
+    #pragma omp parallel for schedule(static)
+    for (uword b = 0; b < n_blocks; b++) {
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        block_sums(b) = arma::accu(values.subvec(r0, r1));
+    }
+
+    arma::dvec cumulative = arma::cumsum(block_sums);
+    double total = cumulative(n_blocks - 1);
+    index_vec draws(n_draws);
+
+    for (uword d = 0; d < n_draws; d++) {
+        // Uniform draw when every value is zero (all rows already selected)
+        if (total <= 0) {
+            draws(d) = std::min((uword)(arma::randu<double>() * N), N - 1);
+            continue;
+        }
+
+        double r = arma::randu<double>() * total;
+        uword b = std::min((uword)(std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin()), n_blocks - 1);
+        double acc = (b > 0) ? cumulative(b - 1) : 0.0;
+
+        uword r0 = b * KMEANS_BLOCK_SIZE;
+        uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+        uword i = r0;
+        // Skip zero values so already selected rows (zeroed by the callers) are never drawn
+        uword last_positive = r0;
+        for (; i <= r1; i++) {
+            if (values(i) > 0) {last_positive = i;}
+            acc += values(i);
+            if ((acc > r) && (values(i) > 0)) {break;}
+        }
+        draws(d) = (i <= r1) ? i : last_positive;
+    }
+
+    return draws;
+}
+
+/*
+Selects n_clusters rows of data with the greedy k-means++ algorithm 
+(Arthur & Vassilvitskii, 2007, as in scikit-learn).
+
+The first center is drawn at random (proportionally to the weights), then 
+each step draws n_local_trials candidates with probability proportional to 
+w * D^2, the weighted squared distance to the closest selected center, and 
+keeps the candidate that lowers the total potential the most. The distances 
+to the closest center are kept and lowered incrementally, and every pass 
+over the data is blocked and parallel.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+weights : arma::dvec
+    Weight of each sample.
+n_clusters : uword
+    Number of centers to select.
+n_local_trials : int, optional
+    Candidates per step, values <= 0 use 2 + log(n_clusters). 1 gives the 
+    vanilla k-means++ algorithm. Defaults to 0.
+seeds : index_vec, optional
+    Already selected rows, the selection continues from them. Defaults to empty.
+
+Returns
+-------
+index_vec
+    Selected rows in selection order (seeds first).
+*/
+index_vec GreedyKmeansPlusPlus(const Matrix &data, const arma::dvec &weights, uword n_clusters,
+                               int n_local_trials, const index_vec &seeds)
+{
+    uword N = data.n_rows;
+
+    if (n_clusters > N) {
+        throw std::length_error("The number of clusters is larger than the number of samples.\n");
+    }
+    if (weights.n_elem != N) {
+        throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+    }
+    if (n_local_trials <= 0) {
+        n_local_trials = 2 + (int)std::log((double)std::max<uword>(n_clusters, 1));
+    }
+
+    index_vec selected = ValidateSeeds(seeds, N);
+    if (selected.n_elem >= n_clusters) {return selected.head(n_clusters);}
+
+    vector data_norms = RowSquaredNorms(data);
+    vector closest(N);
+    closest.fill(INFINITY);
+    index_vec no_owner;
+
+    if (selected.is_empty()) {
+        selected = SampleProportional(weights, 1);
+    }
+    UpdateClosest(data, data_norms, data.rows(selected), closest, no_owner, 0);
+    // The expanded float distance of a row to itself may leave a positive residue
+    closest.elem(selected).zeros();
+
+    uword n_selected = selected.n_elem;
+    selected.resize(n_clusters);
+
+    for (uword c = n_selected; c < n_clusters; c++) {
+        arma::dvec values = weights % arma::conv_to<arma::dvec>::from(closest);
+        index_vec candidates = SampleProportional(values, n_local_trials);
+        Matrix trials = data.rows(candidates);
+
+        uword best = 0;
+        if (candidates.n_elem > 1) {
+            best = TrialPotentials(data, data_norms, weights, closest, trials).index_min();
+        }
+
+        selected(c) = candidates(best);
+        UpdateClosest(data, data_norms, trials.row(best), closest, no_owner, 0);
+        closest(selected(c)) = 0;
+    }
+
+    return selected;
+}
+
+/*
+Greedy k-means++ with unit weights. See GreedyKmeansPlusPlus with weights.
+*/
+index_vec GreedyKmeansPlusPlus(const Matrix &data, uword n_clusters, int n_local_trials,
+                               const index_vec &seeds)
+{
+    return GreedyKmeansPlusPlus(data, arma::dvec(data.n_rows, arma::fill::ones), n_clusters, n_local_trials, seeds);
+}
+
+/*
+Selects n_clusters rows of data with the scalable k-means|| algorithm 
+(Bahmani et al., 2012).
+
+Starting from a random row, each round samples every row independently with
+probability oversampling * D^2 / potential, in parallel with a random stream
+per block of rows, and lowers the squared distances to the closest candidate
+incrementally with the new candidates only. The candidates are then weighted
+by the number of rows closest to them and reduced to n_clusters centers with
+the weighted greedy k-means++ algorithm. The data is passed over once per 
+round instead of once per center.
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+n_clusters : uword
+    Number of centers to select.
+oversampling : double, optional
+    Expected number of candidates per round, values <= 0 use 2 * n_clusters.
+    Defaults to 0.
+n_rounds : uword, optional
+    Number of sampling rounds. Defaults to KMEANS_PARALLEL_ROUNDS.
+
+Returns
+-------
+index_vec
+    Selected rows. Unlike the greedy algorithm the selection for k clusters 
+    is not a prefix of the selection for more clusters.
+*/
+index_vec KmeansParallel(const Matrix &data, uword n_clusters, double oversampling, uword n_rounds)
+{
+    uword N = data.n_rows;
+    uword n_blocks = (N + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+
+    if (n_clusters > N) {
+        throw std::length_error("The number of clusters is larger than the number of samples.\n");
+    }
+    if (oversampling <= 0) {oversampling = 2.0 * n_clusters;}
+
+    vector data_norms = RowSquaredNorms(data);
+    vector closest(N);
+    closest.fill(INFINITY);
+    index_vec owner(N, arma::fill::zeros);
+
+    std::vector<uword> candidates;
+    candidates.push_back(std::min((uword)(arma::randu<double>() * N), N - 1));
+    UpdateClosest(data, data_norms, data.rows(index_vec{candidates[0]}), closest, owner, 0);
+    // Candidates own themselves, whatever residue the expanded float distance leaves
+    closest(candidates[0]) = 0;
+
+    for (uword round = 0; round < n_rounds; round++) {
+        double potential = arma::accu(arma::conv_to<arma::dvec>::from(closest));
+        if (potential <= 0) {break;}
+
+        // One random stream per block, seeded from the armadillo generator
+        unsigned long long round_seed = RandomSeed();
+        std::vector<std::vector<uword>> block_picks(n_blocks);
+
+        #pragma omp parallel for schedule(static)
+        for (uword b = 0; b < n_blocks; b++) {
+            std::mt19937_64 generator(round_seed + 0x9E3779B97F4A7C15ULL * (b + 1));
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            uword r0 = b * KMEANS_BLOCK_SIZE;
+            uword r1 = std::min(r0 + KMEANS_BLOCK_SIZE, N) - 1;
+            for (uword i = r0; i <= r1; i++) {
+                if ((closest(i) > 0) && (uniform(generator) < oversampling * closest(i) / potential)) {
+                    block_picks[b].push_back(i);
+                }
+            }
+        }
+
+        std::vector<uword> picks;
+        for (uword b = 0; b < n_blocks; b++) {
+            picks.insert(picks.end(), block_picks[b].begin(), block_picks[b].end());
+        }
+        if (picks.empty()) {continue;}
+
+        UpdateClosest(data, data_norms, data.rows(index_vec(picks)), closest, owner, candidates.size());
+        for (uword p = 0; p < picks.size(); p++) {
+            closest(picks[p]) = 0;
+            owner(picks[p]) = candidates.size() + p;
+        }
+        candidates.insert(candidates.end(), picks.begin(), picks.end());
+    }
+
+    index_vec candidate_rows(candidates);
+
+    // Too few candidates, continue greedily from them
+    if (candidate_rows.n_elem <= n_clusters) {
+        return GreedyKmeansPlusPlus(data, n_clusters, 0, candidate_rows);
+    }
+
+    // Weight of each candidate: number of rows closest to it
+    arma::dvec weights(candidate_rows.n_elem, arma::fill::zeros);
+    for (uword i = 0; i < N; i++) {weights(owner(i)) += 1;}
+
+    index_vec reduced = GreedyKmeansPlusPlus(data.rows(candidate_rows), weights, n_clusters);
+
+    return candidate_rows.elem(reduced);
+}
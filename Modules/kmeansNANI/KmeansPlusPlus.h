@@ -0,0 +1,25 @@
+#ifndef KMEANS_PLUS_PLUS_H
+#define KMEANS_PLUS_PLUS_H
+#include <random>
+#include "../../Datatypes/DataContainers.h"
+#include "../../Tools/BTS/DiversitySelection.h"
+#include "KmeansEngine.h"
+
+// Default number of oversampling rounds of k-means||
+#define KMEANS_PARALLEL_ROUNDS 5
+
+// Greedy k-means++ seeding, returns the selected rows in selection order.
+// n_local_trials <= 0 uses 2 + log(n_clusters), 1 gives vanilla k-means++.
+// The selection continues from the rows in seeds when given.
+index_vec GreedyKmeansPlusPlus(const Matrix &data, uword n_clusters, int n_local_trials = 0,
+                               const index_vec &seeds = index_vec());
+
+// Weighted greedy k-means++ seeding, each row counts weights(i) times
+index_vec GreedyKmeansPlusPlus(const Matrix &data, const arma::dvec &weights, uword n_clusters,
+                               int n_local_trials = 0, const index_vec &seeds = index_vec());
+
+// Scalable k-means|| seeding (oversampled rounds reclustered by weighted k-means++)
+index_vec KmeansParallel(const Matrix &data, uword n_clusters, double oversampling = 0,
+                         uword n_rounds = KMEANS_PARALLEL_ROUNDS);
+
+#endif // !KMEANS_PLUS_PLUS_H
@@ -0,0 +1,228 @@
+#include "KmeansSweep.h"
+
+/*
+Constructor of the KmeansSweep class, the squared norms of the samples are 
+computed once for all the runs.
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Input dataset, must outlive the sweep.
+metric : Metric enum {'MSD', 'RR', 'JT', etc}
+    Metric used for extended comparisons.
+n_atoms : int
+    Number of atoms.
+n_iter : int, optional
+    Max number of iterations of each run. Default is 20.
+percentage : int, optional
+    Percentage of the dataset to be used for the initial selection of the 
+    initial centers. Default is 10.
+*/
+KmeansSweep::KmeansSweep(const Matrix &data, Metric metric, int n_atoms, uword n_iter, unsigned short int percentage)
+    : m_data(data)
+{
+    this->m_norms = RowSquaredNorms(data);
+    this->m_metric = metric;
+    this->n_atoms = n_atoms;
+    this->n_iter = n_iter;
+    this->percentage = percentage;
+}
+
+/*
+Runs k-means for every initiator and every cluster count from start_n_clusters
+to end_n_clusters, and scores each run.
+
+The initial centers are selected once per initiator for end_n_clusters (the 
+greedy initiators give the centers for k clusters as the first k rows, 
+KMEANS_PARALLEL is selected for each k), reading the shared dataset in place 
+(see InitiatorIndices). The runs then share the dataset, see KmeansSweep::RunAll.
+
+Parameters
+----------
+initiators : std::vector<Initiator>
+    Initiators to sweep.
+start_n_clusters : int
+    Smallest number of clusters.
+end_n_clusters : int
+    Largest number of clusters (inclusive).
+
+Returns
+-------
+std::vector<sweep_result>
+    Scores of every run, by initiator then increasing number of clusters.
+*/
+std::vector<sweep_result> KmeansSweep::Run(const std::vector<Initiator> &initiators, int start_n_clusters, int end_n_clusters)
+{
+    if ((start_n_clusters < 1) || (end_n_clusters < start_n_clusters)) {
+        throw std::invalid_argument("Invalid range of cluster counts.\n");
+    }
+
+    uword n_counts = end_n_clusters - start_n_clusters + 1;
+    uword n_runs = initiators.size() * n_counts;
+    std::vector<Matrix> init_centroids(n_runs);
+
+    // Initial centers, selected serially (the selections are parallel and share the random generator)
+    for (uword p = 0; p < initiators.size(); p++) {
+        index_vec top_indices;
+        index_vec init_indices;
+        index_vec selection;
+        if (initiators[p] == Initiator::RANDOM) {
+            selection = arma::randperm(this->m_data.n_rows, end_n_clusters);
+        } else if (initiators[p] != Initiator::KMEANS_PARALLEL) {
+            selection = InitiatorIndices(this->m_data, initiators[p], end_n_clusters, this->m_metric, this->n_atoms,
+                                         this->percentage, arma::dvec(), top_indices, init_indices);
+        }
+
+        for (uword c = 0; c < n_counts; c++) {
+            int n_clusters = start_n_clusters + c;
+            if (initiators[p] == Initiator::KMEANS_PARALLEL) {
+                selection = InitiatorIndices(this->m_data, initiators[p], n_clusters, this->m_metric, this->n_atoms,
+                                             this->percentage, arma::dvec(), top_indices, init_indices);
+            }
+            init_centroids[p * n_counts + c] = this->m_data.rows(selection.head(n_clusters));
+        }
+    }
+
+    std::vector<Initiator> run_initiators(n_runs);
+    for (uword r = 0; r < n_runs; r++) {run_initiators[r] = initiators[r / n_counts];}
+
+    return this->RunAll(init_centroids, run_initiators);
+}
+
+/*
+Runs the sweep from precomputed initial centers (e.g. loaded from a file).
+
+Parameters
+----------
+init_centroids : 2D Matrix (n_centers, n_features)
+    Initial centers, the first k rows are used for k clusters.
+start_n_clusters : int
+    Smallest number of clusters.
+end_n_clusters : int
+    Largest number of clusters (inclusive), at most n_centers.
+initiator : Initiator enum, optional
+    Initiator the centers were selected with, recorded in the results. 
+    Default is COMP_SIM.
+
+Returns
+-------
+std::vector<sweep_result>
+    Scores of every run, by increasing number of clusters.
+*/
+std::vector<sweep_result> KmeansSweep::Run(const Matrix &init_centroids, int start_n_clusters, int end_n_clusters,
+                                           Initiator initiator)
+{
+    if ((start_n_clusters < 1) || (end_n_clusters < start_n_clusters)) {
+        throw std::invalid_argument("Invalid range of cluster counts.\n");
+    }
+    if ((int)init_centroids.n_rows < end_n_clusters) {
+        throw std::length_error("The number of initiators is less than the number of clusters.\n");
+    }
+
+    uword n_counts = end_n_clusters - start_n_clusters + 1;
+    std::vector<Matrix> centroids(n_counts);
+    for (uword c = 0; c < n_counts; c++) {
+        centroids[c] = init_centroids.rows(0, start_n_clusters + c - 1);
+    }
+
+    return this->RunAll(centroids, std::vector<Initiator>(n_counts, initiator));
+}
+
+/*
+Runs k-means from every set of initial centers and scores each run. The runs
+share the dataset and its norms and are spread over the cores with dynamic 
+scheduling, largest cluster counts first, so idle threads pick up the 
+remaining runs. Each run uses a single thread: the nested parallel regions 
+of the engines run on the calling thread and BLAS is limited to one thread 
+for the sweep.
+*/
+std::vector<sweep_result> KmeansSweep::RunAll(const std::vector<Matrix> &init_centroids,
+                                              const std::vector<Initiator> &run_initiators)
+{
+    uword n_runs = init_centroids.size();
+    std::vector<sweep_result> results(n_runs);
+
+    // Largest cluster counts first
+    std::vector<uword> order(n_runs);
+    for (uword r = 0; r < n_runs; r++) {order[r] = r;}
+    std::stable_sort(order.begin(), order.end(), [&init_centroids](uword a, uword b) {
+        return init_centroids[a].n_rows > init_centroids[b].n_rows;
+    });
+
+    // The runs are spread over the OpenMP threads, so BLAS calls within a run stay serial
+    int blas_threads = openblas_get_num_threads();
+    openblas_set_num_threads(1);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (uword r = 0; r < n_runs; r++) {
+        uword run = order[r];
+        int n_clusters = init_centroids[run].n_rows;
+
+        kmeans_result result = RunKmeans(this->m_data, this->m_norms, init_centroids[run], this->n_iter,
+                                         this->tolerance, this->algorithm);
+        cluster_stats stats = ClusterStatistics(this->m_data, result.labels, n_clusters);
+        vector comparison = ClusterComparison(stats, this->m_metric, this->n_atoms);
+
+        results[run].initiator = run_initiators[run];
+        results[run].n_clusters = n_clusters;
+        results[run].n_iter = result.n_iter;
+        results[run].inertia = result.inertia;
+        results[run].ch = CalinskiHarabaszScore(stats);
+        results[run].db = DaviesBouldinScore(this->m_data, result.labels, stats);
+        if (this->compute_silhouette) {
+            results[run].sil = SilhouetteScore(this->m_data, result.labels, n_clusters,
+                                               this->silhouette_size, this->silhouette_seed);
+        }
+        // Average over the non-empty clusters
+        results[run].msd = (stats.n_present() > 0) ? arma::mean(comparison.elem(arma::find_finite(comparison))) : 0.0f;
+
+        if (this->printSteps) {
+            printf("%s, %d clusters: %llu iterations, inertia %.6f\n", toStr(run_initiators[run]).c_str(),
+                   n_clusters, result.n_iter, result.inertia);
+        }
+    }
+
+    openblas_set_num_threads(blas_threads);
+
+    return results;
+}
+
+/*
+Collects the scores of one initiator in the table format of the screens.
+
+Parameters
+----------
+results : std::vector<sweep_result>
+    Results of KmeansSweep::Run.
+initiator : Initiator enum
+    Initiator to collect.
+
+Returns
+-------
+Matrix (n_runs, 5 or 6)
+    Number of clusters, number of iterations, Calinski-Harabasz score, 
+    Davies-Bouldin score, average MSD and, when the sweep computed it, 
+    silhouette score of each run.
+*/
+Matrix SweepTable(const std::vector<sweep_result> &results, Initiator initiator)
+{
+    std::vector<const sweep_result*> rows;
+    for (const sweep_result &result : results) {
+        if (result.initiator == initiator) {rows.push_back(&result);}
+    }
+
+    bool has_silhouette = false;
+    for (const sweep_result *row : rows) {has_silhouette |= !std::isnan(row->sil);}
+
+    Matrix table(rows.size(), has_silhouette ? 6 : 5);
+    for (uword i = 0; i < rows.size(); i++) {
+        table(i, 0) = rows[i]->n_clusters;
+        table(i, 1) = rows[i]->n_iter;
+        table(i, 2) = rows[i]->ch;
+        table(i, 3) = rows[i]->db;
+        table(i, 4) = rows[i]->msd;
+        if (has_silhouette) {table(i, 5) = rows[i]->sil;}
+    }
+
+    return table;
+}
@@ -0,0 +1,90 @@
+#ifndef KMEANS_SWEEP_H
+#define KMEANS_SWEEP_H
+#include <vector>
+#include "nani.h"
+
+// Scores of one (initiator, n_clusters) run of a sweep
+struct sweep_result
+{
+    sweep_result() {
+        initiator = Initiator::COMP_SIM;
+        n_clusters = 0;
+        n_iter = 0;
+        inertia = 0.0;
+        ch = 0.0;
+        db = 0.0;
+        msd = 0.0;
+        sil = arma::datum::nan;
+    }
+    Initiator initiator;
+    int n_clusters;
+    uword n_iter;
+    double inertia;
+    // Calinski-Harabasz score
+    float ch;
+    // Davies-Bouldin score
+    float db;
+    // Average extended comparison of the non-empty clusters
+    float msd;
+    // Silhouette score, NaN if the sweep does not compute it
+    float sil;
+};
+
+/*
+K-means runs over a range of cluster counts and initiators on one shared dataset.
+
+Attributes
+----------
+m_data : 2D matrix (n_samples, n_features)
+    Input dataset, referenced and never copied (it must outlive the sweep).
+m_norms : vector
+    Squared norm of each sample, shared by every run.
+m_metric : Metric enum {'MSD', 'RR', 'JT', etc}
+    Metric used for the initiators and the cluster extended comparisons.
+n_atoms : int
+    Number of atoms.
+n_iter : int
+    Max number of iterations of each run.
+percentage : int
+    Percentage of the dataset used by the NANI initiators.
+*/
+class KmeansSweep
+{
+public:
+    KmeansSweep(const Matrix &data, Metric metric, int n_atoms, uword n_iter = 20, unsigned short int percentage = 10);
+
+    std::vector<sweep_result> Run(const std::vector<Initiator> &initiators, int start_n_clusters, int end_n_clusters);
+
+    // Sweep from precomputed initial centers, the first k rows are used for k clusters
+    std::vector<sweep_result> Run(const Matrix &init_centroids, int start_n_clusters, int end_n_clusters,
+                                  Initiator initiator = Initiator::COMP_SIM);
+
+    bool printSteps = false;
+
+    // Relative tolerance on the centroid shift, see ScaledTolerance
+    float tolerance = 1e-4;
+
+    // K-means engine, see KmeansEngine.h
+    Algorithm algorithm = Algorithm::LLOYD;
+
+    // Whether every run is also scored with the (sampled) silhouette, off by default
+    bool compute_silhouette = false;
+
+    // Number of samples of the silhouette score (0 for the exact score), one sample shared by every run
+    uword silhouette_size = SILHOUETTE_SAMPLE_SIZE;
+    unsigned long long silhouette_seed = 0;
+private:
+    std::vector<sweep_result> RunAll(const std::vector<Matrix> &init_centroids, const std::vector<Initiator> &run_initiators);
+
+    const Matrix &m_data;
+    vector m_norms;
+    Metric m_metric;
+    int n_atoms;
+    uword n_iter;
+    unsigned short int percentage;
+};
+
+// Score table of one initiator, columns (n_clusters, n_iter, CH, DB, average MSD[, silhouette])
+Matrix SweepTable(const std::vector<sweep_result> &results, Initiator initiator);
+
+#endif // !KMEANS_SWEEP_H
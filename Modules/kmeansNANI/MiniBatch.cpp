@@ -0,0 +1,241 @@
+#include "MiniBatch.h"
+
+/*
+Draws random row indices, sorted so chunk sources read them in file order.
+
+Parameters
+----------
+n_rows : uword
+    Number of rows to draw from.
+n_samples : uword
+    Number of draws.
+unique : bool, optional
+    Remove repeated draws, the result then holds at most n_samples indices.
+    Defaults to false.
+
+Returns
+-------
+index_vec
+    Sorted row indices.
+*/
+index_vec SampleIndices(uword n_rows, uword n_samples, bool unique)
+{
+    if ((n_rows == 0) || (n_samples == 0)) {return index_vec();}
+
+    // Draw without an O(n_rows) permutation so huge sources stay cheap
+    arma::dvec draws = arma::floor(arma::randu<arma::dvec>(n_samples) * n_rows);
+    index_vec indices = arma::conv_to<index_vec>::from(draws);
+    indices.clamp(0, n_rows - 1);
+
+    if (unique) {return arma::unique(indices);}
+
+    return arma::sort(indices);
+}
+
+/*
+Mini-batch k-means on the rows of a chunk source (Sculley, 2010).
+
+Each step reads a random batch of rows, assigns them to their closest 
+centroid and moves every centroid towards the mean of its batch samples with
+a per-centroid learning rate of 1 / (number of samples assigned so far), so 
+each centroid is the running mean of all the samples it has received. Only 
+the batch and the centroids are held in memory.
+
+The steps stop after max_steps, when the squared centroid shift of a step is 
+below the tolerance (scaled by the feature variance of the first batch), or 
+when the smoothed batch inertia has not improved for max_no_improvement steps.
+
+Parameters
+----------
+source : ChunkSource
+    Input dataset (n_samples, n_features).
+init_centroids : Matrix (n_clusters, n_features)
+    Initial centroids, e.g. from KmeansNANI::InitiateKmeans.
+batch_size : uword
+    Number of rows per batch.
+max_steps : uword
+    Maximum number of batches.
+tolerance : float, optional
+    Relative tolerance on the centroid shift, see ScaledTolerance. Defaults to 1e-4.
+max_no_improvement : uword, optional
+    Number of steps without improvement of the smoothed batch inertia before 
+    stopping, 0 disables it. Defaults to 10.
+compute_labels : bool, optional
+    Run a streaming label pass over the whole source at the end (O(n_samples)
+    labels are returned). Otherwise labels are left empty and the inertia is 
+    the last smoothed batch inertia scaled to n_samples, see StreamLabels to 
+    consume the labels chunk by chunk. Defaults to true.
+print_steps : bool, optional
+    Print the progress of each step. Defaults to false.
+
+Returns
+-------
+kmeans_result
+    Labels, centroids, number of steps run and inertia.
+*/
+kmeans_result MiniBatchKmeans(
+    const ChunkSource &source, const Matrix &init_centroids, uword batch_size,
+    uword max_steps, float tolerance, uword max_no_improvement,
+    bool compute_labels, bool print_steps)
+{
+    uword N = source.n_rows();
+    uword M = source.n_cols();
+    uword k = init_centroids.n_rows;
+
+    if ((k == 0) || (N == 0) || (init_centroids.n_cols != M)) {
+        throw std::invalid_argument("Initial centroids do not match the dataset.\n");
+    }
+    if (batch_size == 0) {
+        throw std::invalid_argument("The batch size must be positive.\n");
+    }
+
+    kmeans_result result;
+    Matrix centroids = init_centroids;
+    arma::dvec counts(k, arma::fill::zeros);
+    double abs_tolerance = 0.0;
+
+    // Smoothed batch inertia (per sample) for early stopping
+    double alpha = std::min(1.0, 2.0 * batch_size / (N + 1.0));
+    double ewa_inertia = -1.0;
+    double ewa_min = INFINITY;
+    uword no_improvement = 0;
+
+    for (uword step = 0; step < max_steps; step++) {
+        Matrix batch = source.ReadRows(SampleIndices(N, batch_size));
+        if (step == 0) {abs_tolerance = ScaledTolerance(batch, tolerance);}
+
+        vector min_distances;
+        index_vec labels = AssignLabels(batch, RowSquaredNorms(batch), centroids, min_distances);
+        double batch_inertia = arma::accu(arma::conv_to<arma::dvec>::from(min_distances)) / batch.n_rows;
+
+        // Per-cluster batch sums, the columns are independent
+        arma::dmat sums(k, M, arma::fill::zeros);
+        arma::dvec batch_counts(k, arma::fill::zeros);
+        for (uword i = 0; i < batch.n_rows; i++) {batch_counts(labels(i)) += 1;}
+        #pragma omp parallel for schedule(static)
+        for (uword j = 0; j < M; j++) {
+            const float *column = batch.colptr(j);
+            for (uword i = 0; i < batch.n_rows; i++) {
+                sums(labels(i), j) += column[i];
+            }
+        }
+
+        // c += (sum - b c) / v, with v the samples the centroid has received
+        double shift = 0.0;
+        for (uword c = 0; c < k; c++) {
+            if (batch_counts(c) <= 0) {continue;}
+            counts(c) += batch_counts(c);
+            arma::drowvec old_centroid = arma::conv_to<arma::drowvec>::from(centroids.row(c));
+            arma::drowvec new_centroid = old_centroid + (sums.row(c) - batch_counts(c) * old_centroid) / counts(c);
+            shift += arma::accu(arma::square(new_centroid - old_centroid));
+            centroids.row(c) = arma::conv_to<rvector>::from(new_centroid);
+        }
+
+        ewa_inertia = (ewa_inertia < 0) ? batch_inertia : (1 - alpha) * ewa_inertia + alpha * batch_inertia;
+        result.n_iter = step + 1;
+
+        if (print_steps) {
+            printf("Step %llu: batch inertia %.6f, smoothed %.6f, centroid shift %.6e\n",
+                   result.n_iter, batch_inertia, ewa_inertia, shift);
+        }
+
+        if ((step > 0) && (shift <= abs_tolerance)) {
+            result.converged = true;
+            break;
+        }
+
+        if (ewa_inertia < ewa_min) {
+            ewa_min = ewa_inertia;
+            no_improvement = 0;
+        } else if ((max_no_improvement > 0) && (++no_improvement >= max_no_improvement)) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    result.centroids = centroids;
+    if (compute_labels) {
+        result.labels = StreamLabels(source, centroids, result.inertia);
+    } else {
+        result.inertia = ewa_inertia * N;
+    }
+
+    return result;
+}
+
+/*
+Mini-batch k-means on an in-memory matrix. See MiniBatchKmeans with a ChunkSource.
+*/
+kmeans_result MiniBatchKmeans(
+    const Matrix &data, const Matrix &init_centroids, uword batch_size,
+    uword max_steps, float tolerance, uword max_no_improvement,
+    bool compute_labels, bool print_steps)
+{
+    MatrixSource source(data);
+    return MiniBatchKmeans(source, init_centroids, batch_size, max_steps, tolerance,
+                           max_no_improvement, compute_labels, print_steps);
+}
+
+/*
+Assigns every row of the source to its closest centroid, reading chunk_size 
+rows at a time, so only one chunk is held in memory.
+
+Parameters
+----------
+source : ChunkSource
+    Input dataset (n_samples, n_features).
+centroids : Matrix (n_clusters, n_features)
+    Centroids.
+sink : label_sink
+    Called once per chunk, in order, with the index of the first row of the 
+    chunk and the labels of its rows.
+chunk_size : uword, optional
+    Number of rows per chunk. Defaults to STREAM_CHUNK_SIZE.
+
+Returns
+-------
+double
+    Inertia of the labels.
+*/
+double StreamLabels(const ChunkSource &source, const Matrix &centroids,
+                    const label_sink &sink, uword chunk_size)
+{
+    uword N = source.n_rows();
+    double inertia = 0.0;
+    if (chunk_size == 0) {chunk_size = STREAM_CHUNK_SIZE;}
+
+    for (uword first = 0; first < N; first += chunk_size) {
+        uword last = std::min(first + chunk_size, N) - 1;
+        Matrix chunk = source.ReadRows(first, last);
+
+        vector min_distances;
+        index_vec labels = AssignLabels(chunk, RowSquaredNorms(chunk), centroids, min_distances);
+        inertia += arma::accu(arma::conv_to<arma::dvec>::from(min_distances));
+
+        sink(first, labels);
+    }
+
+    return inertia;
+}
+
+/*
+Streaming label pass that collects the labels of every row. See StreamLabels 
+with a label_sink.
+
+Returns
+-------
+index_vec
+    Label of each row, inertia holds the inertia of the labels.
+*/
+index_vec StreamLabels(const ChunkSource &source, const Matrix &centroids,
+                       double &inertia, uword chunk_size)
+{
+    index_vec labels(source.n_rows());
+
+    inertia = StreamLabels(source, centroids,
+        [&labels](uword first, const index_vec &chunk_labels) {
+            labels.subvec(first, first + chunk_labels.n_elem - 1) = chunk_labels;
+        }, chunk_size);
+
+    return labels;
+}
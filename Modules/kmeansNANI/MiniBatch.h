@@ -0,0 +1,36 @@
+#ifndef MINI_BATCH_H
+#define MINI_BATCH_H
+#include <functional>
+#include "../../Datatypes/DataContainers.h"
+#include "KmeansEngine.h"
+
+// Number of rows read per chunk by the streaming label pass
+#define STREAM_CHUNK_SIZE 65536
+
+// Receives the labels of the rows first to first + labels.n_elem - 1 of a streaming pass
+typedef std::function<void(uword first, const index_vec &labels)> label_sink;
+
+// Sorted random row indices, n_samples drawn with replacement
+index_vec SampleIndices(uword n_rows, uword n_samples, bool unique = false);
+
+// Mini-batch k-means with per-centroid learning rates on a chunk source
+kmeans_result MiniBatchKmeans(
+    const ChunkSource &source, const Matrix &init_centroids, uword batch_size,
+    uword max_steps, float tolerance = 1e-4, uword max_no_improvement = 10,
+    bool compute_labels = true, bool print_steps = false);
+
+// Mini-batch k-means on an in-memory matrix
+kmeans_result MiniBatchKmeans(
+    const Matrix &data, const Matrix &init_centroids, uword batch_size,
+    uword max_steps, float tolerance = 1e-4, uword max_no_improvement = 10,
+    bool compute_labels = true, bool print_steps = false);
+
+// Streams the rows of source by chunks and passes the label of each row to sink
+double StreamLabels(const ChunkSource &source, const Matrix &centroids,
+                    const label_sink &sink, uword chunk_size = STREAM_CHUNK_SIZE);
+
+// Streams the rows of source by chunks and collects the labels of every row
+index_vec StreamLabels(const ChunkSource &source, const Matrix &centroids,
+                       double &inertia, uword chunk_size = STREAM_CHUNK_SIZE);
+
+#endif // !MINI_BATCH_H
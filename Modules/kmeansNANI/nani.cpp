@@ -1,5 +1,8 @@
 #include "nani.h"
+#include "KmeansModel.h"
 #include <chrono>
+#include <random>
+#include <unordered_set>
 
 using std::chrono::high_resolution_clock;
 using std::chrono::duration;
@@ -16,12 +19,13 @@ n_clusters : int
 metric : Metric enum {'MSD', 'RR', 'JT', etc}
     Metric used for extended comparisons. 
     See `...Datatypes.DataContainers.h` for all available metrics.
-initiator : Initiator enum {COMP_SIM, DIV_SELECT, VANILLA_KMEANS, RANDOM}
+initiator : Initiator enum {COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL}
     'COMP_SIM' selects the inital centers based on the diversity in the densest region of the data.
     'DIV_SELECT' selects the initial centers based on the highest diversity of all data.
     'KMEANS' selects the initial centers based on the greedy k-means++ algorithm.
     'RANDOM' selects the initial centers randomly.
     'VANILLA_KMEANS' selects the initial centers based on the vanilla k-means++ algorithm
+    'KMEANS_PARALLEL' selects the initial centers based on the scalable k-means|| algorithm.
 n_atoms : int
     Number of atoms. Default is 10.
 percentage : int
@@ -37,6 +41,34 @@ KmeansNANI::KmeansNANI(Matrix data, int n_clusters, Metric metric, int n_atoms,
     this->m_initiator = initiator;
     this->percentage = percentage;
     this->n_iter = n_iter;
+    this->m_cached_initiator = initiator;
+}
+
+/*
+Constructor of the KmeansNANI class on a subset of the rows of data.
+
+The selected rows are gathered once into the object, so an index set such as
+the kept rows of TrimOutlierIndices can be clustered without first building
+a trimmed copy of the dataset. Labels refer to the position in rows.
+
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Input dataset.
+rows : index_vec
+    Indices of the rows of data to cluster.
+See KmeansNANI::KmeansNANI for the remaining parameters.
+*/
+KmeansNANI::KmeansNANI(const Matrix &data, const index_vec &rows, int n_clusters, Metric metric, int n_atoms, Initiator initiator, uword n_iter, unsigned short int percentage)
+{
+    this->m_data = data.rows(rows);
+    this->n_clusters = n_clusters;
+    this->m_metric = metric;
+    this->n_atoms = n_atoms;
+    this->m_initiator = initiator;
+    this->percentage = percentage;
+    this->n_iter = n_iter;
+    this->m_cached_initiator = initiator;
 }
 
 /*
@@ -59,93 +91,262 @@ void KmeansNANI::Clear()
     this->n_atoms = 1;
     this->m_initiator = Initiator::COMP_SIM;
     this->percentage = 100;
+    this->m_top_indices.reset();
+    this->m_init_indices.reset();
+    this->m_weights.reset();
 }
 
+/*
+Sets the weight of each sample and drops the cached initiation, which was 
+selected for the previous weights.
+
+Parameters
+----------
+weights : arma::dvec
+    Weight of each sample (n_samples), empty to count every sample once.
+*/
+void KmeansNANI::setWeights(const arma::dvec &weights)
+{
+    if (!weights.is_empty() && (weights.n_elem != this->m_data.n_rows)) {
+        throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+    }
+    this->m_weights = weights;
+    this->m_top_indices.reset();
+    this->m_init_indices.reset();
+}
 
 /*
 Initializes the k-means algorithm with the selected initiating method
-(COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS).
+(COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL) for the object's number of clusters.
 
 Defaults to COMP_SIM, RANDOM is handled by the clustering function.
 
 Parameters
 ----------
-initiator : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS)
+initiator : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL)
 
 
 Returns
 -------
 Matrix
-    The initial centers for k-means of shape (n_features, n_clusters).
+    The initial centers for k-means of shape (n_clusters, n_features).
 */
 Matrix KmeansNANI::InitiateKmeans(Initiator initiator)
 {
-    index_vec initiators_indices;
+    return this->InitiateKmeans(initiator, this->n_clusters);
+}
+
+
+/*
+Initializes the k-means algorithm with the selected initiating method
+(COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL), selecting 
+max_clusters centers.
+
+The diversity selection and k-means++ are greedy, so the first k rows of the 
+result are the initial centers for k clusters (this does not hold for the 
+KMEANS_PARALLEL reclustering, which is recomputed for every cluster count). The ordered selection is cached and later calls 
+with the same initiator reuse it, only extending it when more centers are 
+requested, so a cluster-count sweep needs a single selection run.
+
+Parameters
+----------
+initiator : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL)
+max_clusters : int
+    Largest number of clusters the initial centers will be used for.
 
-    if (initiator == Initiator::DIV_SELECT) {
-        initiators_indices = DiversitySelection(this->m_data, this->percentage, this->m_metric, DiversitySeed::MEDOID, this->n_atoms);
-        return this->m_data.rows(initiators_indices);
+Returns
+-------
+Matrix
+    The initial centers for k-means of shape (max_clusters, n_features).
+*/
+Matrix KmeansNANI::InitiateKmeans(Initiator initiator, int max_clusters)
+{
+    if (initiator == Initiator::RANDOM) {
+        // Random initiation is handled by the clustering function
+        initiator = Initiator::COMP_SIM;
     }
-    // Kmeans++ Initialization
-    // Vanilla Kmeans++ Initialization
-    // Comp sim / default
-    uword n_total = this->m_data.n_rows;
-    uword n_max = (uword)(n_total * this->percentage / 100);
-    vector comp_sim = CalculateCompSim(this->m_data, this->m_metric, this->n_atoms);
-    index_vec sorted_comp_sim = arma::sort_index(comp_sim, "descend");
 
-    index_vec total_comp_indices = sorted_comp_sim.subvec(0, n_max-1);
+    if (initiator != this->m_cached_initiator) {
+        this->m_top_indices.reset();
+        this->m_init_indices.reset();
+        this->m_cached_initiator = initiator;
+    }
 
-    Matrix top_cc_data = this->m_data.rows(total_comp_indices);
-    
     auto t1 = high_resolution_clock::now();
-    initiators_indices = DiversitySelection(top_cc_data, 100, this->m_metric, DiversitySeed::MEDOID, this->n_atoms);
-    auto t2 = high_resolution_clock::now();
-    /* Getting number of milliseconds as a double. */
-    duration<double, std::milli> ms_double = t2 - t1;
-    std::cout << "Diversity Selection took " << ms_double.count() << "ms\n";
+    index_vec initiators_indices = InitiatorIndices(this->m_data, initiator, max_clusters, this->m_metric, this->n_atoms,
+                                                    this->percentage, this->m_weights, this->m_top_indices, this->m_init_indices);
+    if (this->printSteps) {
+        duration<double, std::milli> ms_double = high_resolution_clock::now() - t1;
+        printf("%s initiation took %.3fms\n", toStr(initiator).c_str(), ms_double.count());
+    }
+
+    return this->m_data.rows(initiators_indices);
+}
+
+/*
+Ordered selection of the initial centers of data with a NANI or k-means++ 
+initiator, see KmeansNANI::InitiateKmeans.
 
-    Matrix result = top_cc_data.rows(initiators_indices);
+The selection is read from and extended into top_indices and init_indices, 
+so a caller keeping them between calls with the same initiator (and data, 
+weights and percentage) only selects the additional centers. The dataset is
+only read, so a sweep can select its initial centers without copying it.
 
-    if ((int)result.n_cols < this->n_clusters) {
+Parameters
+----------
+data : 2D Matrix (n_samples, n_features)
+    Input dataset.
+initiator : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL)
+max_clusters : int
+    Largest number of clusters the initial centers will be used for.
+metric : Metric enum {'MSD', 'RR', 'JT', etc}
+    Metric used for extended comparisons.
+n_atoms : int
+    Number of atoms.
+percentage : int
+    Percentage of the dataset (of the total weight) used by the NANI initiators.
+weights : arma::dvec
+    Weight of each sample, empty if every sample counts once.
+top_indices : index_vec
+    Cached top comp sim rows (COMP_SIM), empty if the full dataset was used.
+init_indices : index_vec
+    Cached ordered selection, relative to top_indices when it is set.
+
+Returns
+-------
+index_vec
+    Rows of data of the max_clusters initial centers, in selection order.
+*/
+index_vec InitiatorIndices(const Matrix &data, Initiator initiator, int max_clusters, Metric metric, int n_atoms,
+                           unsigned short int percentage, const arma::dvec &weights,
+                           index_vec &top_indices, index_vec &init_indices)
+{
+    uword n_total = data.n_rows;
+    uword n_max = (uword)(n_total * percentage / 100);
+    uword n_select = (max_clusters > 0) ? (uword)max_clusters : 1;
+    bool is_weighted = !weights.is_empty();
+
+    if (is_weighted) {
+        if (weights.n_elem != n_total) {
+            throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+        }
+        n_max = (uword)(arma::accu(weights) * percentage / 100);
+    }
+
+    if (initiator == Initiator::RANDOM) {
+        initiator = Initiator::COMP_SIM;
+    }
+
+    // K-means++ initiations select from the full dataset
+    bool is_kmeans_pp = (initiator == Initiator::KMEANS) || (initiator == Initiator::VANILLA_KMEANS) ||
+                        (initiator == Initiator::KMEANS_PARALLEL);
+
+    if (is_kmeans_pp && (n_select > n_total)) {
+        throw std::length_error("The number of clusters is larger than the number of samples.\n");
+    }
+
+    if (!is_kmeans_pp && (n_select > n_max)) {
+        throw std::length_error("The number of initiators is less than the number of clusters. Try increasing the percentage.\n");
+    }
+
+    if ((initiator == Initiator::KMEANS_PARALLEL) && (init_indices.n_elem != n_select)) {
+        init_indices = KmeansParallel(data, n_select);
+    }
+
+    // Reuse the cached selection if it already covers the requested clusters
+    if (init_indices.n_elem < n_select) {
+        if ((initiator == Initiator::KMEANS) || (initiator == Initiator::VANILLA_KMEANS)) {
+            // Vanilla k-means++ draws a single candidate per step
+            int n_local_trials = (initiator == Initiator::VANILLA_KMEANS) ? 1 : 0;
+            if (is_weighted) {
+                init_indices = GreedyKmeansPlusPlus(data, weights, n_select, n_local_trials, init_indices);
+            } else {
+                init_indices = GreedyKmeansPlusPlus(data, n_select, n_local_trials, init_indices);
+            }
+        } else if (initiator == Initiator::DIV_SELECT) {
+            if (init_indices.is_empty()) {
+                int medoid = is_weighted ? CalculateMedoid(data, weights, metric, n_atoms)
+                                         : CalculateMedoid(data, metric, n_atoms);
+                init_indices = index_vec{(uword)medoid};
+            }
+            init_indices = DiversitySelectionN(data, n_select, metric, init_indices, n_atoms);
+        } else {
+            if (top_indices.is_empty() && is_weighted) {
+                // Highest comp sim rows until they hold the top percentage of the total weight
+                vector comp_sim = CalculateCompSim(data, weights, metric, n_atoms);
+                top_indices = TopWeightIndices(comp_sim, weights, (double)n_max, true);
+            } else if (top_indices.is_empty()) {
+                vector comp_sim = CalculateCompSim(data, metric, n_atoms);
+                // Only the top percentage is ranked, kept in descending order for parity with MDANCE
+                top_indices = TopKIndices(comp_sim, n_max, true, true);
+            }
+
+            Matrix top_cc_data = data.rows(top_indices);
+
+            if (init_indices.is_empty()) {
+                int medoid = is_weighted ? CalculateMedoid(top_cc_data, arma::dvec(weights.elem(top_indices)),
+                                                           metric, n_atoms)
+                                         : CalculateMedoid(top_cc_data, metric, n_atoms);
+                init_indices = index_vec{(uword)medoid};
+            }
+            init_indices = DiversitySelectionN(top_cc_data, n_select, metric, init_indices, n_atoms);
+        }
+    }
+
+    index_vec initiators_indices = init_indices.head(n_select);
+
+    if (!top_indices.is_empty()) {
+        initiators_indices = top_indices.elem(initiators_indices);
+    }
+
+    if (initiators_indices.n_elem < n_select) {
         throw std::length_error("The number of initiators is less than the number of clusters. Try increasing the percentage.\n");
     }
 
-    return result;
+    return initiators_indices;
 }
 
 
 /*
-Executes the k-means algorithm with given initial centroid matrix.
+Executes the k-means algorithm with given initial centroid matrix, using the
+engine selected by the algorithm attribute.
 
 Parameters
 ----------
-initiators : 2D Matrix of (n_features, n_clusters)    
+initiators : 2D Matrix of (n_centers, n_features)
+    Initial centers, the first n_clusters rows are used.
 
 Returns
 -------
 cluster_data
     Struct containing:
         - The labels of each point to the closest centroid
-        - Matrix of centroids
-        - Maximum allowed iterations.
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of iterations run
+        - Inertia (sum of squared distances to the closest centroid)
+        - Statistics of each cluster, see cluster_data::ClusterMSD
 */
 cluster_data KmeansNANI::KmeansClustering(Matrix init_centroids)
 {
-    Matrix centroids = init_centroids.rows(0, this->n_clusters-1).t();
-    Matrix data = this->m_data.t();
+    if ((int)init_centroids.n_rows < this->n_clusters) {
+        throw std::length_error("The number of initiators is less than the number of clusters.\n");
+    }
 
-    arma::kmeans(centroids, data, this->n_clusters, 
-            arma::keep_existing, this->n_iter, this->printSteps);
+    Matrix centroids = init_centroids.rows(0, this->n_clusters-1);
+
+    kmeans_result result = RunKmeans(this->m_data, RowSquaredNorms(this->m_data), centroids, 
+                                     this->n_iter, this->tolerance, this->algorithm, this->printSteps,
+                                     this->m_weights);
 
     // Return:
     // - Matrix of this->m_data's shape where every point is the
     //      corresponding group the point is connected to
     // - Centroid matrix
-    // - number of max iterations
-    vector labels = GenerateLabels(data, centroids);
-
-    return cluster_data(labels, centroids, this->n_iter);
+    // - number of iterations run and inertia
+    // - statistics of each cluster, for the per-cluster extended comparisons
+    cluster_data data(result.labels, result.centroids.t(), result.n_iter, result.inertia);
+    data.stats = ClusterStatistics(this->m_data, result.labels, this->n_clusters, this->m_weights);
+    return data;
 }
 
 
@@ -157,8 +358,9 @@ Returns
 cluster_data
     Struct containing:
         - The labels of each point to the closest centroid
-        - Matrix of centroids
-        - Maximum allowed iterations.
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of iterations run
+        - Inertia (sum of squared distances to the closest centroid)
 */
 cluster_data KmeansNANI::KmeansClustering(){
     return this->KmeansClustering(this->m_initiator);
@@ -167,24 +369,31 @@ cluster_data KmeansNANI::KmeansClustering(){
 
 /*
 Executes the k-means algorithm with given initiator to generate
-starting centroid
+starting centroid. Stochastic initiators run n_init restarts, see 
+KmeansNANI::KmeansRestarts.
 
 Parameters
 ----------
-initiators : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM)
+initiators : Initiator enum (COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL)
 
 Returns
 -------
 cluster_data
     Struct containing:
         - The labels of each point to the closest centroid
-        - Matrix of centroids
-        - Maximum allowed iterations.
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of iterations run
+        - Inertia (sum of squared distances to the closest centroid)
 */
 cluster_data KmeansNANI::KmeansClustering(Initiator initiator)
 {
+    // The NANI initiators are deterministic, restarts would all be the same
+    bool is_stochastic = (initiator != Initiator::COMP_SIM) && (initiator != Initiator::DIV_SELECT);
+    if (is_stochastic && (this->n_init > 1)) {
+        return this->KmeansRestarts(initiator, this->n_init);
+    }
+
     Matrix centroids;
-    Matrix data = this->m_data.t();
 
     switch (initiator)
     {
@@ -192,26 +401,315 @@ cluster_data KmeansNANI::KmeansClustering(Initiator initiator)
         case Initiator::COMP_SIM:
         case Initiator::VANILLA_KMEANS:
         case Initiator::KMEANS:
+        case Initiator::KMEANS_PARALLEL:
             centroids = this->InitiateKmeans(initiator);
-            centroids = centroids.rows(0, this->n_clusters-1).t();
-            arma::kmeans(centroids, data, this->n_clusters, 
-            arma::keep_existing, this->n_iter, this->printSteps);
             break;
         case Initiator::RANDOM:
         default:
-            arma::kmeans(centroids, data, this->n_clusters,
-            arma::random_subset, this->n_iter, this->printSteps);
+            // Random subset of the samples
+            centroids = this->m_data.rows(arma::randperm(this->m_data.n_rows, this->n_clusters));
             break;
     }
 
-    // Return:
-    // - Matrix of this->m_data's shape where every point is the
-    //      corresponding group the point is connected to
-    // - Centroid matrix
-    // - number of max iterations
-    vector labels = GenerateLabels(data, centroids);
-    
-    return cluster_data(labels, centroids, this->n_iter);
+    return this->KmeansClustering(centroids);
+}
+
+/*
+Distinct random rows drawn from a std random stream.
+*/
+static index_vec RandomRows(uword n_rows, uword n_select, unsigned long long seed)
+{
+    std::mt19937_64 generator(seed);
+    std::uniform_int_distribution<uword> uniform(0, n_rows - 1);
+    std::unordered_set<uword> seen;
+    index_vec rows(n_select);
+
+    for (uword i = 0; i < n_select;) {
+        uword row = uniform(generator);
+        if (seen.insert(row).second) {rows(i++) = row;}
+    }
+
+    return rows;
+}
+
+/*
+Executes n_init independent k-means restarts and keeps the one with the lowest 
+inertia.
+
+Each restart gets its own random stream, seeded from the armadillo generator,
+so the restarts are reproducible with arma::arma_rng::set_seed and do not 
+depend on scheduling. The initial centers are selected serially (the k-means++
+selections are parallel themselves), then the restarts run concurrently with 
+one thread each.
+
+Parameters
+----------
+initiator : Initiator enum (RANDOM, KMEANS, VANILLA_KMEANS, KMEANS_PARALLEL)
+    Stochastic initiator, COMP_SIM and DIV_SELECT run once.
+n_init : int
+    Number of restarts.
+
+Returns
+-------
+cluster_data
+    Struct containing:
+        - The labels of each point to the closest centroid
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of iterations run
+        - Inertia (sum of squared distances to the closest centroid)
+        - Inertia of every restart, in restart order
+*/
+cluster_data KmeansNANI::KmeansRestarts(Initiator initiator, int n_init)
+{
+    uword N = this->m_data.n_rows;
+    uword k = this->n_clusters;
+
+    if ((initiator == Initiator::COMP_SIM) || (initiator == Initiator::DIV_SELECT) || (n_init < 1)) {
+        n_init = 1;
+    }
+    if (k > N) {
+        throw std::length_error("The number of clusters is larger than the number of samples.\n");
+    }
+
+    std::vector<unsigned long long> seeds(n_init);
+    for (int r = 0; r < n_init; r++) {seeds[r] = RandomSeed();}
+    unsigned long long next_seed = RandomSeed();
+
+    std::vector<Matrix> init_centroids(n_init);
+    for (int r = 0; r < n_init; r++) {
+        switch (initiator)
+        {
+            case Initiator::KMEANS:
+            case Initiator::VANILLA_KMEANS:
+                arma::arma_rng::set_seed(seeds[r]);
+                init_centroids[r] = this->m_data.rows(this->m_weights.is_empty()
+                    ? GreedyKmeansPlusPlus(this->m_data, k, (initiator == Initiator::VANILLA_KMEANS) ? 1 : 0)
+                    : GreedyKmeansPlusPlus(this->m_data, this->m_weights, k, (initiator == Initiator::VANILLA_KMEANS) ? 1 : 0));
+                break;
+            case Initiator::KMEANS_PARALLEL:
+                arma::arma_rng::set_seed(seeds[r]);
+                init_centroids[r] = this->m_data.rows(KmeansParallel(this->m_data, k));
+                break;
+            case Initiator::RANDOM:
+                init_centroids[r] = this->m_data.rows(RandomRows(N, k, seeds[r]));
+                break;
+            default:
+                init_centroids[r] = this->InitiateKmeans(initiator);
+                break;
+        }
+    }
+    // Move the shared generator on so later calls do not repeat the last stream
+    arma::arma_rng::set_seed(next_seed);
+
+    vector norms = RowSquaredNorms(this->m_data);
+    std::vector<kmeans_result> results(n_init);
+
+    // The restarts are spread over the OpenMP threads, so BLAS calls within a restart stay serial
+    int blas_threads = openblas_get_num_threads();
+    openblas_set_num_threads(1);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int r = 0; r < n_init; r++) {
+        results[r] = RunKmeans(this->m_data, norms, init_centroids[r], this->n_iter, this->tolerance, this->algorithm,
+                               false, this->m_weights);
+    }
+
+    openblas_set_num_threads(blas_threads);
+
+    arma::dvec restart_inertia(n_init);
+    for (int r = 0; r < n_init; r++) {restart_inertia(r) = results[r].inertia;}
+    uword best = restart_inertia.index_min();
+
+    if (this->printSteps) {
+        printf("%d restarts: best inertia %.6f (restart %llu), mean %.6f, max %.6f\n", n_init,
+               restart_inertia(best), best, arma::mean(restart_inertia), arma::max(restart_inertia));
+    }
+
+    cluster_data data(results[best].labels, results[best].centroids.t(), results[best].n_iter, results[best].inertia);
+    data.restart_inertia = restart_inertia;
+    data.stats = ClusterStatistics(this->m_data, data.labels, k, this->m_weights);
+
+    return data;
+}
+
+/*
+Executes mini-batch k-means from the object's initiator. The initial centers
+are selected on the whole dataset, see MiniBatchNANI for data that does not 
+fit in memory.
+
+Parameters
+----------
+batch_size : uword
+    Number of samples per batch.
+max_steps : uword, optional
+    Maximum number of batches. Defaults to 100.
+
+Returns
+-------
+cluster_data
+    Struct containing:
+        - The labels of each point to the closest centroid
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of batches run
+        - Inertia (sum of squared distances to the closest centroid)
+*/
+cluster_data KmeansNANI::MiniBatchClustering(uword batch_size, uword max_steps)
+{
+    Matrix centroids;
+
+    if (!this->m_weights.is_empty()) {
+        fprintf(stderr, "Mini-batch k-means does not support weights, the samples are clustered unweighted\n");
+    }
+
+    if (this->m_initiator == Initiator::RANDOM) {
+        centroids = this->m_data.rows(arma::randperm(this->m_data.n_rows, this->n_clusters));
+    } else {
+        centroids = this->InitiateKmeans(this->m_initiator);
+    }
+
+    kmeans_result result = MiniBatchKmeans(this->m_data, centroids, batch_size, max_steps,
+                                           this->tolerance, 10, true, this->printSteps);
+
+    cluster_data data(result.labels, result.centroids.t(), result.n_iter, result.inertia);
+    data.stats = ClusterStatistics(this->m_data, result.labels, this->n_clusters);
+    return data;
+}
+
+/*
+Mini-batch k-means on a chunk source, seeded by NANI.
+
+The initial centers are selected by the NANI initiator on a random sample of 
+the rows, then the centroids are refined by mini-batches and the labels are 
+assigned in a streaming pass, so only the sample, a batch and a chunk of rows 
+are held in memory at any time (plus the labels when compute_labels is set).
+
+Parameters
+----------
+source : ChunkSource
+    Input dataset (n_samples, n_features), e.g. a NPYChunkReader.
+n_clusters : int
+    Number of clusters.
+metric : Metric enum {'MSD', 'RR', 'JT', etc}
+    Metric used for extended comparisons.
+n_atoms : int
+    Number of atoms.
+initiator : Initiator enum {COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL}
+    Initiator used on the sample.
+batch_size : uword
+    Number of rows per batch.
+max_steps : uword, optional
+    Maximum number of batches. Defaults to 100.
+percentage : int, optional
+    Percentage of the sample used for the initial selection. Defaults to 10.
+sample_size : uword, optional
+    Number of rows drawn for the initiation, 0 uses max(3 * batch_size, 
+    100 * n_clusters). Defaults to 0.
+compute_labels : bool, optional
+    Return the label of every row, see MiniBatchKmeans. Defaults to true.
+
+Returns
+-------
+cluster_data
+    Struct containing:
+        - The labels of each point to the closest centroid
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of batches run
+        - Inertia (sum of squared distances to the closest centroid)
+*/
+cluster_data MiniBatchNANI(const ChunkSource &source, int n_clusters, Metric metric, int n_atoms,
+                           Initiator initiator, uword batch_size, uword max_steps,
+                           unsigned short int percentage, uword sample_size,
+                           bool compute_labels)
+{
+    uword N = source.n_rows();
+    if (sample_size == 0) {
+        sample_size = std::max<uword>(3 * batch_size, 100 * (uword)n_clusters);
+    }
+
+    Matrix centroids;
+    {
+        Matrix sample = (sample_size >= N) ? source.ReadRows(0, N - 1)
+                                           : source.ReadRows(SampleIndices(N, sample_size, true));
+
+        if (initiator == Initiator::RANDOM) {
+            centroids = sample.rows(arma::randperm(sample.n_rows, n_clusters));
+        } else {
+            KmeansNANI sample_mod(sample, n_clusters, metric, n_atoms, initiator, max_steps, percentage);
+            centroids = sample_mod.InitiateKmeans(initiator);
+        }
+    }
+
+    kmeans_result result = MiniBatchKmeans(source, centroids, batch_size, max_steps,
+                                           1e-4, 10, compute_labels);
+
+    return cluster_data(result.labels, result.centroids.t(), result.n_iter, result.inertia);
+}
+
+/*
+K-means on a chunk source through a coreset, seeded by NANI.
+
+A coreset of coreset_size draws is built in three streaming passes (see 
+BuildCoreset), the weighted NANI initiation and k-means run on the coreset 
+only (see KmeansNANI::setWeights), then every row is assigned to the closest 
+centroid in one more streaming pass. Only the coreset and a chunk of rows are
+held in memory at any time (plus the labels when compute_labels is set).
+
+Parameters
+----------
+source : ChunkSource
+    Input dataset (n_samples, n_features), e.g. a NPYChunkReader.
+n_clusters : int
+    Number of clusters.
+metric : Metric enum {'MSD', 'RR', 'JT', etc}
+    Metric used for extended comparisons.
+n_atoms : int
+    Number of atoms.
+initiator : Initiator enum {COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL}
+    Initiator used on the coreset.
+coreset_size : uword
+    Number of coreset draws, see CoresetSize.
+n_iter : uword, optional
+    Maximum number of k-means iterations on the coreset. Defaults to 100.
+percentage : int, optional
+    Percentage of the coreset weight used for the initial selection. Defaults to 10.
+compute_labels : bool, optional
+    Stream the full dataset for the labels and the exact inertia, otherwise 
+    the inertia is the coreset estimate. Defaults to true.
+seed : unsigned long long, optional
+    Seed of the coreset draws. Defaults to 0.
+
+Returns
+-------
+cluster_data
+    Struct containing:
+        - The labels of each point to the closest centroid
+        - Matrix of centroids (n_features, n_clusters)
+        - Number of iterations run on the coreset
+        - Inertia (sum of squared distances to the closest centroid)
+        - Statistics of each cluster of the coreset (weighted)
+*/
+cluster_data CoresetNANI(const ChunkSource &source, int n_clusters, Metric metric, int n_atoms,
+                         Initiator initiator, uword coreset_size, uword n_iter,
+                         unsigned short int percentage, bool compute_labels,
+                         unsigned long long seed)
+{
+    coreset core = BuildCoreset(source, coreset_size, seed);
+
+    if (core.size() < (uword)n_clusters) {
+        throw std::length_error("The coreset has fewer rows than the number of clusters. Try increasing its size.\n");
+    }
+
+    KmeansNANI core_mod(core.frames, n_clusters, metric, n_atoms, initiator, n_iter, percentage);
+    core_mod.setWeights(core.weights);
+    cluster_data data = core_mod.KmeansClustering();
+
+    if (compute_labels) {
+        data.labels = StreamLabels(source, Matrix(data.centers.t()), data.inertia);
+    } else {
+        data.labels.reset();
+    }
+
+    return data;
 }
 
 /*
@@ -220,7 +718,7 @@ the vector of indices that correspond to the cluster.
 
 Parameters
 ----------
-labels : vector
+labels : index_vec
     Labels of the k-means algorithm.
 
 Returns
@@ -228,19 +726,116 @@ Returns
 cluster_indices
     arma::field map with labels as keys and the indices of the data as values.
 */
-cluster_indices KmeansNANI::CreateClusterList(vector labels)
+cluster_indices KmeansNANI::CreateClusterList(const index_vec &labels)
 {
-    cluster_indices list(this->n_clusters);
+    return ::CreateClusterList(labels, this->n_clusters);
+}
+
+/*
+Creates a mapping between the cluster labels and the vector of indices that 
+correspond to the cluster, from a single counting sort pass (see GroupByLabel).
+
+Parameters
+----------
+labels : index_vec
+    Labels of the k-means algorithm.
+n_clusters : uword
+    Number of clusters.
 
-    for (int i = 0; i < n_clusters; i++)
-    {   
-        index_vec indicies = arma::find(labels == i);
-        list(i) = indicies;
+Returns
+-------
+cluster_indices
+    arma::field map with labels as keys and the indices of the data as values.
+*/
+cluster_indices CreateClusterList(const index_vec &labels, uword n_clusters)
+{
+    cluster_csr groups = GroupByLabel(labels, n_clusters);
+    cluster_indices list(n_clusters);
+
+    for (uword c = 0; c < n_clusters; c++)
+    {
+        list(c) = groups.cluster(c);
     }
-    
+
     return list;
 }
 
+/*
+Labels of the samples from a list of clusters, samples that are in no cluster
+get the label n_clusters.
+*/
+static index_vec ClusterLabels(const cluster_indices &clusters, uword n_samples)
+{
+    index_vec labels(n_samples);
+    labels.fill(clusters.n_elem);
+    for (uword k = 0; k < clusters.n_elem; k++) {
+        labels.elem(clusters(k)).fill(k);
+    }
+    return labels;
+}
+
+/*
+Computes the Davies-Bouldin, Calinski-Harabasz and silhouette scores from the
+labels, with a single pass over the data for the cluster statistics and one 
+for the Davies-Bouldin scatter (see ClusterStatistics). The silhouette score 
+is pairwise, so it is only computed when requested, on a random sample of 
+silhouette_size rows (see SilhouetteScore).
+
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+labels : index_vec
+    Label of each sample.
+n_clusters : uword
+    Number of clusters.
+silhouette_size : uword, optional
+    Number of samples of the silhouette score, SILHOUETTE_EXACT (or any 
+    size of at least n_samples) for the exact score. Defaults to 0, which 
+    skips the silhouette.
+seed : unsigned long long, optional
+    Seed of the silhouette sample. Defaults to 0.
+
+Returns
+-------
+scores
+    Struct containing the Davies-Bouldin, Calinski-Harabasz and silhouette 
+    scores, the silhouette is NaN when it is skipped.
+*/
+scores ComputeDataScores(const Matrix &data, const index_vec &labels, uword n_clusters,
+                         uword silhouette_size, unsigned long long seed)
+{
+    return ComputeDataScores(data, labels, n_clusters, arma::dvec(), silhouette_size, seed);
+}
+
+/*
+Computes the Davies-Bouldin, Calinski-Harabasz and silhouette scores of a 
+weighted dataset, where sample i counts weights(i) times (e.g. deduplicated
+frames and their multiplicities). The scores match those of the dataset with
+every sample repeated, see ComputeDataScores.
+
+Parameters
+----------
+weights : arma::dvec
+    Weight of each sample, empty if every sample counts once.
+See ComputeDataScores for the remaining parameters.
+
+Returns
+-------
+scores
+    Struct containing the Davies-Bouldin, Calinski-Harabasz and silhouette scores.
+*/
+scores ComputeDataScores(const Matrix &data, const index_vec &labels, uword n_clusters,
+                         const arma::dvec &weights, uword silhouette_size, unsigned long long seed)
+{
+    cluster_stats stats = ClusterStatistics(data, labels, n_clusters, weights);
+    float ch_score = CalinskiHarabaszScore(stats);
+    float db_score = DaviesBouldinScore(data, labels, stats, weights);
+    float sil_score = (silhouette_size > 0) ? SilhouetteScore(data, labels, n_clusters, weights, silhouette_size, seed)
+                                            : arma::datum::nan;
+    return scores(ch_score, db_score, sil_score);
+}
+
 /*
 Computes the Davies-Bouldin and Calinski-Harabasz scores.
 
@@ -259,11 +854,9 @@ Returns
 scores
     Struct containing the Davies-Bouldin and Calinski-Harabasz scores.
 */
-scores ComputeDataScores(Matrix data, Matrix centers, cluster_indices clusters)
+scores ComputeDataScores(const Matrix &data, const Matrix &centers, const cluster_indices &clusters)
 {
-    float ch_score = CalinskiHarabaszScore(data, centers, clusters);
-    float db_score = DaviesBouldinScore(data, centers, clusters);
-    return scores(ch_score, db_score);
+    return ComputeDataScores(data, ClusterLabels(clusters, data.n_rows), clusters.n_elem);
 }
 
 /*
@@ -285,6 +878,9 @@ scores
 */
 scores KmeansNANI::ComputeScores(Matrix centers, cluster_indices labels)
 {
+    if (!this->m_weights.is_empty()) {
+        return ComputeDataScores(this->m_data, ClusterLabels(labels, this->m_data.n_rows), labels.n_elem, this->m_weights);
+    }
     return ComputeDataScores(this->m_data, centers, labels);
 }
 
@@ -325,7 +921,67 @@ void KmeansNANI::WriteCentroids(Matrix centers, std::string filename)
 }
 
 /*
-Generate vector of centroid labels based on the closest centroid to each data point
+Collects the parameters of the object, the hash of its dataset and the scores
+of a clustering of it (when the labels cover the dataset) for a KmeansModel.
+
+Parameters
+----------
+data : cluster_data
+    Result of a clustering of the object.
+
+Returns
+-------
+model_info
+    Initiator, metric, number of atoms, iterations, inertia, fit scores and 
+    data hash.
+*/
+model_info KmeansNANI::ModelInfo(const cluster_data &data)
+{
+    model_info info;
+    info.initiator = this->m_initiator;
+    info.metric = this->m_metric;
+    info.n_atoms = this->n_atoms;
+    info.n_iter = data.n_iter;
+    info.inertia = data.inertia;
+    info.data_hash = DataHash(this->m_data);
+    if (data.labels.n_elem == this->m_data.n_rows) {
+        info.fit_scores = ComputeDataScores(this->m_data, data.labels, data.centers.n_cols, this->m_weights);
+    }
+
+    return info;
+}
+
+/*
+Writes the result of a clustering to a binary model file (see 
+KmeansModel::Save) with the centroids, labels, cluster statistics, the 
+parameters of the object, the scores of the clustering and the hash of the
+dataset, so the model can be reloaded with KmeansModel::Load without 
+recomputing anything.
+
+Parameters
+----------
+data : cluster_data
+    Result of KmeansClustering on the object's dataset.
+filename : std::string, optional
+    Output file. Defaults to "model.bin".
+*/
+void KmeansNANI::WriteModel(const cluster_data &data, std::string filename)
+{
+    if (data.centers.is_empty()) {return;}
+
+    std::filesystem::path path(filename);
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path().string());
+    }
+
+    KmeansModel(data, this->ModelInfo(data)).Save(filename);
+}
+
+/*
+Generate vector of centroid labels based on the closest centroid to each data point.
+
+The squared distances are computed by blocks of rows as |x|^2 - 2 x.c + |c|^2 
+with one GEMM per block, in parallel, see AssignLabels.
 
 Parameters
 ----------
@@ -333,44 +989,31 @@ data : 2D Matrix (n_samples, n_features)
     Input dataset
 centroids : 2D Matrix (n_features, n_clusters)
     center values 
+min_distances : vector
+    Output squared distance of each sample to its closest centroid.
+
 Returns
 -------
-vector
+index_vec
     vector of center labels corresponding to each sample
 */
-vector GenerateLabels(Matrix data, Matrix centroids)
+index_vec GenerateLabels(const Matrix &data, const Matrix &centroids, vector &min_distances)
 {
-    // Create a label list with number of features
-    vector labelVector(data.n_cols);
-
-    // Initialize variables 
-    float minimum_distance; // Minimal distance for label calculation
-    vector square_diff; // Squared difference between all elements 
-    float distance; // Distance calculated for the given center
-    int label; // Corresponding label index for element
-
-    // Iterate over all features and their corresponding labelVector index
-    for (uword i = 0; i < data.n_cols; i++)
-    {
-        // Initialize minimum distance 
-        minimum_distance = MAXFLOAT;
-        for (uword center = 0; center < centroids.n_cols; center++)
-        {
-            // Calculate euclidian distance between center and feature
-            square_diff = arma::pow((centroids.col(center) - data.col(i)), 2);
-            distance = std::sqrt(arma::sum(square_diff));
-
-            // Set label to current center index if the distance is less than minimum
-            if (distance < minimum_distance) {
-                minimum_distance = distance;
-                label = center;
-            }
-
-        }
-        labelVector(i) = label;
+    if (centroids.n_rows != data.n_cols) {
+        throw std::invalid_argument("The centroids do not match the features of the dataset.\n");
     }
 
-    return labelVector;
+    return AssignLabels(data, RowSquaredNorms(data), centroids.t(), min_distances);
+}
+
+/*
+Generate vector of centroid labels based on the closest centroid to each data point.
+See GenerateLabels with min_distances.
+*/
+index_vec GenerateLabels(const Matrix &data, const Matrix &centroids)
+{
+    vector min_distances;
+    return GenerateLabels(data, centroids, min_distances);
 }
 
 /*
@@ -391,111 +1034,185 @@ Returns
 float
     Calculated Calinski and Harabasz Score.
 */
-float CalinskiHarabaszScore(Matrix data, Matrix centers, cluster_indices clusters)
+float CalinskiHarabaszScore(const Matrix &data, const Matrix &centers, const cluster_indices &clusters)
 {
-    Matrix cluster_k;
-    rvector mean = arma::mean(data, COL);
-    rvector mean_k;
-    float bcss = 0.0f;
-    float wcss = 0.0f;
-
-    // Iterate over each cluster and calculate bcss and wcss
-    for (uword k = 0; k < centers.n_cols; k++)
-    {  
-        // Obtain data from clusters
-        cluster_k = data.rows(clusters(k));
-
-        // Calculate mean of current data clusters
-        mean_k = arma::mean(cluster_k, COL);
-
-        // Calcuate bcss
-        bcss += clusters(k).size() * arma::sum(arma::pow((mean_k - mean),2));
-
-        // Calculate wcss
-        wcss += arma::accu(arma::pow((cluster_k.each_row() - mean_k),2));
-    }
-    
-    if (wcss == 0) {
-        return 1.0;
-    }
-
-    return bcss * (data.n_rows - centers.n_cols) / (wcss * (centers.n_cols - 1));
+    return CalinskiHarabaszScore(ClusterStatistics(data, ClusterLabels(clusters, data.n_rows), clusters.n_elem));
 }
 
 /*
-Calculates the Davies-Bouldin score of the data with given label associations.
+Calculates the Davies-Bouldin score of the data with given label associations,
+as sklearn.metrics.davies_bouldin_score. Empty clusters are left out, like 
+labels absent from the data in sklearn.
 
 Parameters
 ----------
 data : Matrix
     Input dataset.
-labels : vector
-    Labels of the k-means algorithm.
+centers : Matrix
+    Matrix of centroid values (n_features, n_clusters), unused (the cluster
+    means are recomputed).
+clusters : cluster_indices
+    Arma field of index vectors corresponding to each cluster
+    (n_clusters, variable length)
 
 Returns
 -------
 float
     Calculated Davies-Bouldin Score.
 */
-float DaviesBouldinScore(Matrix data, Matrix centers, cluster_indices clusters)
+float DaviesBouldinScore(const Matrix &data, const Matrix &centers, const cluster_indices &clusters)
 {
-    /*
+    index_vec labels = ClusterLabels(clusters, data.n_rows);
+    return DaviesBouldinScore(data, labels, ClusterStatistics(data, labels, clusters.n_elem));
+}
+
+/*
+Silhouette coefficient of every sample. The pairwise distances are streamed 
+in parallel tiles (see TiledDistances) and reduced to the sum of the 
+distances of each sample to each cluster, from which a (mean distance to its
+own cluster) and b (lowest mean distance to another cluster) follow. With 
+weights, the distance to sample j counts weights(j) times and counts holds 
+the total weight of each cluster.
+*/
+static arma::dvec SampleSilhouettes(const Matrix &data, const index_vec &labels, uword n_clusters,
+                                    const arma::dvec &counts, const arma::dvec &weights)
+{
+    uword N = data.n_rows;
+    const double *w = weights.is_empty() ? nullptr : weights.memptr();
+    // Sum of the distances of each sample to each cluster
+    arma::dmat cluster_sums(n_clusters, N, arma::fill::zeros);
+
+    TiledDistances<float>(data, data, [&](uword a0, uword b0, const Matrix &tile) {
+        for (uword a = 0; a < tile.n_cols; a++) {
+            double *sums = cluster_sums.colptr(a0 + a);
+            for (uword j = 0; j < tile.n_rows; j++) {
+                // Rounding leaves a small self distance in the expanded form
+                if (b0 + j == a0 + a) {continue;}
+                sums[labels(b0 + j)] += w ? w[b0 + j] * tile(j, a) : tile(j, a);
+            }
+        }
+    });
+
+    arma::dvec silhouettes(N, arma::fill::zeros);
+
+    #pragma omp parallel for schedule(static)
+    for (uword i = 0; i < N; i++) {
+        uword own = labels(i);
+        // Samples alone in their cluster have a silhouette of 0, as in sklearn
+        if (counts(own) <= 1) {continue;}
+
+        double intra = cluster_sums(own, i) / (counts(own) - 1);
+        double inter = arma::datum::inf;
+        for (uword c = 0; c < n_clusters; c++) {
+            if ((c == own) || (counts(c) == 0)) {continue;}
+            inter = std::min(inter, cluster_sums(c, i) / counts(c));
+        }
+
+        double denominator = std::max(intra, inter);
+        silhouettes(i) = (denominator > 0) ? (inter - intra) / denominator : 0.0;
+    }
+
+    return silhouettes;
+}
+
+/*
+Calculates the mean silhouette coefficient of the data with given labels, as
+sklearn.metrics.silhouette_score with the euclidean metric.
+
+The exact score needs every pairwise distance, they are computed in tiles 
+and never stored (O(N^2 M) time, O(N k) memory). With sample_size below the 
+number of samples, the score is computed on a random subset of sample_size 
+rows, both as the scored samples and the reference samples, as with the 
+sample_size argument of sklearn.
+
     Examples
     --------
-    >>> from sklearn.metrics import davies_bouldin_score
+    >>> from sklearn.metrics import silhouette_score
     >>> X = [[0, 1], [1, 1], [3, 4]]
     >>> labels = [0, 0, 1]
-    >>> davies_bouldin_score(X, labels)
-    0.12...
-    */
-
-    // Obtain submatrices based on labels
-    // X, labels = check_X_y(X, labels)
-    // le = LabelEncoder()
-    // labels = le.fit_transform(labels)
-    
-    uword n_features = data.n_cols;
+    >>> silhouette_score(X, labels)
+    0.49...
 
-    // n_labels = len(le.classes_)
-    uword n_clusters = clusters.n_rows;
+Parameters
+----------
+data : Matrix (n_samples, n_features)
+    Input dataset.
+labels : index_vec
+    Label of each sample.
+n_clusters : uword
+    Number of clusters.
+sample_size : uword, optional
+    Number of random samples, 0 for the exact score. Defaults to 0.
+seed : unsigned long long, optional
+    Seed of the random sample. Defaults to 0.
 
-    //
-    // intra_dists = np.zeros(n_labels)
-    std::vector<float>intra_distances(n_clusters);
-    
-    rvector centroid;
-    double average; 
-    // centroids = np.zeros((n_labels, len(X[0])), dtype=float)
-    Matrix centroids(n_clusters, n_features, arma::fill::zeros);
-    // for k in range(n_labels):
-    for (uword k = 0; k < n_clusters; k++){
-        // cluster_k = _safe_indexing(X, labels == k)
-        Matrix data_cluster = data.rows(clusters(k));
-        // centroid = cluster_k.mean(axis=0)
-        centroid = arma::mean(data_cluster, COL);
-        // centroids[k] = centroid
-        centroids.row(k) = centroid;
-
-        // intra_dists[k] = np.average(pairwise_distances(cluster_k, [centroid]))
-        
-        average = arma::mean(MatEuclidian(data_cluster, centroid));
-        intra_distances.at(k) = average;
-    }
-
-    // centroid_distances = pairwise_distances(centroids)
-    // Compare distances between 
-    // if np.allclose(intra_dists, 0) or np.allclose(centroid_distances, 0):
-        // return 0.0
-
-    // centroid_distances[centroid_distances == 0] = np.inf
-    // combined_intra_dists = intra_dists[:, None] + intra_dists
-    // scores = np.max(combined_intra_dists / centroid_distances, axis=1)
-    // return np.mean(scores)
-    return 0.0f;
+Returns
+-------
+float
+    Calculated silhouette score.
+*/
+float SilhouetteScore(const Matrix &data, const index_vec &labels, uword n_clusters,
+                      uword sample_size, unsigned long long seed)
+{
+    return SilhouetteScore(data, labels, n_clusters, arma::dvec(), sample_size, seed);
+}
+
+/*
+Calculates the mean silhouette coefficient of a weighted dataset, where 
+sample i counts weights(i) times. The exact score matches the score of the 
+dataset with every sample repeated (copies of a sample are at distance 0 of 
+each other) and the mean over the samples is weighted. The sampled score 
+draws rows uniformly and keeps their weights.
+
+Parameters
+----------
+weights : arma::dvec
+    Weight of each sample, empty if every sample counts once.
+See SilhouetteScore for the remaining parameters.
+
+Returns
+-------
+float
+    Calculated silhouette score.
+*/
+float SilhouetteScore(const Matrix &data, const index_vec &labels, uword n_clusters,
+                      const arma::dvec &weights, uword sample_size, unsigned long long seed)
+{
+    if (labels.n_elem != data.n_rows) {
+        throw std::invalid_argument("The number of labels does not match the number of samples.\n");
+    }
+    if (!weights.is_empty() && (weights.n_elem != data.n_rows)) {
+        throw std::invalid_argument("The number of weights does not match the number of samples.\n");
+    }
+    if ((sample_size > 0) && (sample_size < data.n_rows)) {
+        index_vec rows = arma::sort(RandomRows(data.n_rows, sample_size, seed));
+        index_vec sample_labels = labels.elem(rows);
+        arma::dvec sample_weights = weights.is_empty() ? arma::dvec() : arma::dvec(weights.elem(rows));
+        return SilhouetteScore(data.rows(rows), sample_labels, n_clusters, sample_weights);
+    }
+    if (arma::any(labels >= n_clusters)) {
+        throw std::invalid_argument("A label is larger than the number of clusters.\n");
+    }
+
+    arma::dvec counts(n_clusters, arma::fill::zeros);
+    for (uword i = 0; i < labels.n_elem; i++) {counts(labels(i)) += weights.is_empty() ? 1 : weights(i);}
+    uword n_present = arma::accu(counts > 0);
+    double n_samples = arma::accu(counts);
+
+    if ((n_present < 2) || (n_present >= n_samples)) {
+        fprintf(stderr, "Number of labels is %llu. Valid values are 2 to n_samples - 1 (inclusive)\n", n_present);
+        return 0.0f;
+    }
+
+    arma::dvec silhouettes = SampleSilhouettes(data, labels, n_clusters, counts, weights);
+    if (weights.is_empty()) {
+        return arma::mean(silhouettes);
+    }
+    return arma::dot(silhouettes, weights) / n_samples;
 }
 
 std::string toStr(Initiator init) {
-    // enum class Initiator { COMP_SIM = 0, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, };
+    // enum class Initiator { COMP_SIM = 0, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL };
     switch (init)
     {
     case Initiator::COMP_SIM:
@@ -508,6 +1225,8 @@ std::string toStr(Initiator init) {
         return std::string("vanilla_kmeans");
     case Initiator::RANDOM:
         return std::string("random");
+    case Initiator::KMEANS_PARALLEL:
+        return std::string("kmeans_parallel");
     default:
         return std::string("initiator");
     }
@@ -3,28 +3,55 @@
 #include "../../Datatypes/DataContainers.h"
 #include "../../Tools/BTS/ComplementarySimilarity.h"
 #include "../../Tools/BTS/DiversitySelection.h"
+#include "KmeansEngine.h"
+#include "MiniBatch.h"
+#include "KmeansPlusPlus.h"
+#include "ClusterStatistics.h"
+#include "Coreset.h"
 
 typedef arma::field<index_vec> cluster_indices;
 
+// Default number of samples of a requested silhouette score (exact below)
+#define SILHOUETTE_SAMPLE_SIZE 10000
+
+// Silhouette size of ComputeDataScores for the exact score (0 skips the silhouette)
+#define SILHOUETTE_EXACT ((uword)-1)
+
+// Parameters and scores of a fit, see KmeansModel.h
+struct model_info;
+
 struct cluster_data
 {   
     cluster_data() {
-        labels = vector();
+        labels = index_vec();
         centers = Matrix();
         n_iter = 0;
+        inertia = 0.0;
     }
-    cluster_data(vector labels_, Matrix centers_, uword n_iter_) {
+    cluster_data(index_vec labels_, Matrix centers_, uword n_iter_, double inertia_ = 0.0) {
         labels = labels_;
         centers = centers_;
         n_iter = n_iter_;
+        inertia = inertia_;
     }
-    vector labels;
+    index_vec labels;
     Matrix centers;
     uword n_iter;
+    // Sum of squared distances of the samples to their closest centroid
+    double inertia;
+    // Inertia of each restart (empty for a single run)
+    arma::dvec restart_inertia;
+    // Counts, column sums and squared column sums of each cluster (empty for chunk sources)
+    cluster_stats stats;
+
+    // Extended comparison of each cluster (NaN for empty clusters)
+    vector ClusterMSD(Metric metric = Metric::MSD, int n_atoms = 1) const {
+        return ClusterComparison(stats, metric, n_atoms);
+    }
 };
 
 // Initiators for the k-means algorithm
-enum class Initiator { COMP_SIM = 0, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, };
+enum class Initiator { COMP_SIM = 0, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL };
 
 std::string toStr(Initiator);
 
@@ -42,13 +69,31 @@ m_metric : Metric enum {'MSD', 'RR', 'JT', etc}
     See `...Datatypes.DataContainers.h` for all available metrics.
 n_atoms : int
     Number of atoms.
-m_initiator : Initiator enum {COMP_SIM, DIV_SELECT, VANILLA_KMEANS, RANDOM}
+m_initiator : Initiator enum {COMP_SIM, DIV_SELECT, KMEANS, VANILLA_KMEANS, RANDOM, KMEANS_PARALLEL}
     Type of initiator selection. 
 n_iter : int
     Max number of iterations run.
+tolerance : float
+    Relative tolerance on the centroid shift used to stop early. Default is 1e-4.
+algorithm : Algorithm enum {LLOYD, HAMERLY, ELKAN}
+    K-means engine used by KmeansClustering. Default is LLOYD.
+n_init : int
+    Number of restarts of the stochastic initiators (RANDOM, KMEANS, 
+    VANILLA_KMEANS, KMEANS_PARALLEL). Default is 1.
 percentage : int
     Percentage of the dataset to be used for the initial selection of the 
     initial centers. Default is 10.
+m_weights : arma::dvec
+    Weight of each sample, empty by default (see setWeights). With weights, the initiators,
+    the k-means engines, the statistics and the scores treat sample i as 
+    weights(i) identical samples (mini-batch k-means is unweighted).
+m_top_indices : index_vec
+    Indices of the data the cached initiation was selected from 
+    (top comp sim frames, empty if the full dataset was used).
+m_init_indices : index_vec
+    Ordered initiation selection (relative to m_top_indices), reused and
+    extended by later InitiateKmeans calls with the same initiator 
+    (KMEANS_PARALLEL selections are only reused for the same cluster count).
 m_labels : vector of length n_samples
     Labels of each point.
 centers : 2D matrix (n_clusters, n_features)
@@ -62,6 +107,9 @@ public:
     // Constructor
     KmeansNANI(Matrix data, int n_clusters, Metric metric, int n_atoms, Initiator initiator, uword n_iter = 10, unsigned short int percentage = 10);
 
+    // Constructor on a subset of rows (e.g. the kept indices of TrimOutlierIndices)
+    KmeansNANI(const Matrix &data, const index_vec &rows, int n_clusters, Metric metric, int n_atoms, Initiator initiator, uword n_iter = 10, unsigned short int percentage = 10);
+
     // Destructor
     ~KmeansNANI();
 
@@ -69,23 +117,51 @@ public:
 
     Matrix InitiateKmeans(Initiator initiator);
 
+    Matrix InitiateKmeans(Initiator initiator, int max_clusters);
+
     cluster_data KmeansClustering(Matrix initiators);
 
     cluster_data KmeansClustering();
 
     cluster_data KmeansClustering(Initiator initiator);
 
-    cluster_indices CreateClusterList(vector labels);
+    cluster_data KmeansRestarts(Initiator initiator, int n_init);
+
+    cluster_data MiniBatchClustering(uword batch_size, uword max_steps = 100);
+
+    cluster_indices CreateClusterList(const index_vec &labels);
 
     scores ComputeScores(Matrix centers, cluster_indices clusters);
 
     void WriteCentroids(Matrix centers, std::string filename = "centroids.csv");
 
+    // Parameters, scores and data hash of a clustering of the object, see KmeansModel
+    model_info ModelInfo(const cluster_data &data);
+
+    // Writes the clustering, its parameters and scores to a binary model file, see KmeansModel
+    void WriteModel(const cluster_data &data, std::string filename = "model.bin");
+
     // cluster_data ExecuteKmeansAll();
 
     bool printSteps = false;
 
+    // Relative tolerance on the centroid shift, see ScaledTolerance
+    float tolerance = 1e-4;
+
+    // K-means engine, see KmeansEngine.h
+    Algorithm algorithm = Algorithm::LLOYD;
+
+    // Number of restarts of the stochastic initiators, the lowest inertia is kept
+    int n_init = 1;
+
     unsigned short int getPercentage(){return this->percentage;};
+
+    void setClusters(int n_clusters){this->n_clusters = n_clusters;};
+
+    // Weight of each sample (e.g. multiplicities of deduplicated frames), empty if every sample counts once
+    void setWeights(const arma::dvec &weights);
+
+    const arma::dvec &getWeights(){return this->m_weights;};
 private:
     Matrix m_data;
     int n_clusters;
@@ -96,40 +172,48 @@ private:
     vector m_labels;
     Matrix centers;
     uword n_iter;
+    arma::dvec m_weights;
+
+    // Cached ordered initiation, any prefix of k rows gives the k initial centers
+    Initiator m_cached_initiator;
+    index_vec m_top_indices;
+    index_vec m_init_indices;
 };
 
-namespace mlpack {
-    class KmeansPlusPlus{
-        public:
-        //! Empty constructor, required by the InitialPartitionPolicy type definition.
-        KmeansPlusPlus();
-
-        /**
-         * Initialize the centroids matrix by kmeans++
-         * matrix.
-         *
-         * @param data Dataset.
-         * @param clusters Number of clusters.
-         * @param centroids Matrix to put initial centroids into.
-         */
-        template<typename MatType>
-        inline static void Cluster(const MatType& data,
-                                    const size_t clusters,
-                                    arma::mat& centroids)
-        {
-            centroids.set_size(data.n_rows, clusters);
-            // for (size_t i = 0; i < clusters; ++i)
-            // {
-            //     // Randomly sample a point.
-            //     const size_t index = RandInt(0, data.n_cols);
-            //     centroids.col(i) = data.col(index);
-            // }
-        }
-    };
-}
-scores ComputeDataScores(Matrix data, Matrix centers, cluster_indices clusters);
-vector GenerateLabels(Matrix data, Matrix centroids);
-
-float CalinskiHarabaszScore(Matrix data, Matrix centers, cluster_indices clusters);
-float DaviesBouldinScore(Matrix data, Matrix centers, cluster_indices clusters);
+// Ordered initial centers (rows of data) of an initiator, read from and extended into the cached selection
+index_vec InitiatorIndices(const Matrix &data, Initiator initiator, int max_clusters, Metric metric, int n_atoms,
+                           unsigned short int percentage, const arma::dvec &weights,
+                           index_vec &top_indices, index_vec &init_indices);
+
+// Mini-batch k-means on a chunk source, seeded by NANI on a random sample of its rows
+cluster_data MiniBatchNANI(const ChunkSource &source, int n_clusters, Metric metric, int n_atoms,
+                           Initiator initiator, uword batch_size, uword max_steps = 100,
+                           unsigned short int percentage = 10, uword sample_size = 0,
+                           bool compute_labels = true);
+
+// NANI and k-means on a coreset of a chunk source, followed by a streaming label pass
+cluster_data CoresetNANI(const ChunkSource &source, int n_clusters, Metric metric, int n_atoms,
+                         Initiator initiator, uword coreset_size, uword n_iter = 100,
+                         unsigned short int percentage = 10, bool compute_labels = true,
+                         unsigned long long seed = 0);
+
+cluster_indices CreateClusterList(const index_vec &labels, uword n_clusters);
+
+// CH and DB scores, plus the silhouette on silhouette_size samples when it is not 0
+scores ComputeDataScores(const Matrix &data, const index_vec &labels, uword n_clusters,
+                         uword silhouette_size = 0, unsigned long long seed = 0);
+scores ComputeDataScores(const Matrix &data, const index_vec &labels, uword n_clusters, const arma::dvec &weights,
+                         uword silhouette_size = 0, unsigned long long seed = 0);
+scores ComputeDataScores(const Matrix &data, const Matrix &centers, const cluster_indices &clusters);
+index_vec GenerateLabels(const Matrix &data, const Matrix &centroids, vector &min_distances);
+index_vec GenerateLabels(const Matrix &data, const Matrix &centroids);
+
+float CalinskiHarabaszScore(const Matrix &data, const Matrix &centers, const cluster_indices &clusters);
+float DaviesBouldinScore(const Matrix &data, const Matrix &centers, const cluster_indices &clusters);
+
+// Mean silhouette coefficient, exact when sample_size is 0 or not below the number of samples
+float SilhouetteScore(const Matrix &data, const index_vec &labels, uword n_clusters,
+                      uword sample_size = 0, unsigned long long seed = 0);
+float SilhouetteScore(const Matrix &data, const index_vec &labels, uword n_clusters, const arma::dvec &weights,
+                      uword sample_size = 0, unsigned long long seed = 0);
 #endif // !NANI_H
\ No newline at end of file
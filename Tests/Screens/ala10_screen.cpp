@@ -52,23 +52,14 @@ int main(int argc, char *argv[]) {
                             n_atoms, init_type, n_iter);
 
                 cluster_data data = mod.KmeansClustering();
-                cluster_indices cluster_list = mod.CreateClusterList(data.labels);
-                scores results = mod.ComputeScores(data.labels, cluster_list);
-
-                cluster_indices cluster_list = mod.CreateClusterList(data.labels);
-                
-                float msd_total = 0;
-                float msd;
-                Matrix sub_mat;
-                for (uword i = 0; i < cluster_list.size(); i++)
-                {
-                    sub_mat = matrix.rows(cluster_list[i]);
-                    msd = ExtendedComparison(sub_mat, metric, 0, n_atoms);
-
-                    msd_total += msd;
-                }
-                std::vector<float> all_scores{float(cluster_list.size()), float(n_iter), 
-                                    results.ch, results.db, msd_total/cluster_list.size()};
+                scores results = ComputeDataScores(matrix, data.labels, n_clusters);
+
+                // Average over the non-empty clusters, from the statistics of the clustering
+                vector msd = data.ClusterMSD(metric, n_atoms);
+                msd = msd.elem(arma::find_finite(msd));
+
+                std::vector<float> all_scores{float(n_clusters), float(data.n_iter), 
+                                    results.ch, results.db, arma::mean(msd)};
                 test_results.push_back(all_scores);
             }
 
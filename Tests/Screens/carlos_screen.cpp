@@ -1,5 +1,5 @@
 #include "../main.h"
-#include "../../Modules/kmeansNANI/nani.h"
+#include "../../Modules/kmeansNANI/KmeansSweep.h"
 #include <chrono>
 
 using std::chrono::high_resolution_clock;
@@ -21,62 +21,29 @@ int main(int argc, char *argv[]) {
     int start_n_clusters = 2;
     int end_n_clusters = 30;
     int sieve = 1;
+    unsigned short int percentage = 10;
 
     // Start of test
     auto start_time = high_resolution_clock::now();
 
     std::filesystem::path path(output_dir);
     std::filesystem::create_directories(path.string());
-    std::vector<std::vector<float>> test_results;
 
     Matrix matrix = loadNPYFile(input_file);
+    int n_iter = 20;
+    KmeansSweep sweep(matrix, metric, n_atoms, n_iter, percentage);
+
     for (Initiator init_type : init_types)
     {
-        int n_iter = 20;
-        KmeansNANI mod(matrix, start_n_clusters, metric,
-                        n_atoms, init_type, n_iter);
-        Matrix initial_centroids;// = mod.InitiateKmeans(init_type);
+        Matrix initial_centroids;
         std::string ic_path = std::string(getenv("ONE_PIECE")) + "/" + std::string("Data/Carlos/initial_centroids.bin");
         initial_centroids.load(ic_path);
-        // ASssume n_cols is always greater than or equal to n_clusters
-        for (int n_clusters = start_n_clusters; n_clusters < end_n_clusters+1; n_clusters++)
-        {
-            
-            KmeansNANI mod(matrix, n_clusters, metric,
-                        n_atoms, init_type, n_iter);
-
-            cluster_data data = mod.KmeansClustering(initial_centroids);
-            cluster_indices cluster_list = mod.CreateClusterList(data.labels);
-            scores results = mod.ComputeScores(data.centers, cluster_list);
-
-            data.centers.brief_print("Centers:");
-
-            
-            float msd_total = 0;
-            float msd;
-            Matrix sub_mat;
-            for (uword i = 0; i < cluster_list.size(); i++)
-            {
-                sub_mat = matrix.rows(cluster_list[i]);
-                msd = ExtendedComparison(sub_mat, metric, 0, n_atoms);
-
-                msd_total += msd;
-            }
-            std::vector<float> all_scores{float(cluster_list.size()), float(n_iter), 
-                                  results.ch, results.db, msd_total/cluster_list.size()};
-            test_results.push_back(all_scores);
-        }
-
-        Matrix output_mat(test_results.at(0).size(), test_results.size());
-        for (size_t i = 0; i < test_results.size(); i++)
-        {
-            output_mat.col(i) = arma::conv_to<vector>::from(test_results.at(i));
-        }
-        
-        output_mat = output_mat.t();
+        // Assume n_rows is always greater than or equal to n_clusters
+        std::vector<sweep_result> sweep_results = sweep.Run(initial_centroids, start_n_clusters, end_n_clusters, init_type);
+        Matrix output_mat = SweepTable(sweep_results, init_type);
 
         std::cout << "Init type: " << toStr(init_type)
-                  << ", Percentage: " << mod.getPercentage()
+                  << ", Percentage: " << percentage
                   << ", Metric: " << toStr(metric)
                   << ", Sieve: " << sieve << std::endl;
         
@@ -84,7 +51,7 @@ int main(int argc, char *argv[]) {
 
         bool status = true;
         
-        sprintf(output, "%s/%d%s_summary.csv", output_dir,mod.getPercentage(),toStr(init_type).c_str());
+        sprintf(output, "%s/%d%s_summary.csv", output_dir,percentage,toStr(init_type).c_str());
         arma::field<std::string> header(output_mat.n_cols);
         if (output_mat.n_cols >= 5) {
             header(0) = std::string("Number of clusters") ;
@@ -92,6 +59,7 @@ int main(int argc, char *argv[]) {
             header(2) = std::string("Calinski-Harabasz score");
             header(3) = std::string("Davies-Bouldin score");
             header(4) = std::string("Average MSD");
+            if (output_mat.n_cols >= 6) {header(5) = std::string("Silhouette score");}
 
             status = output_mat.save(arma::csv_name(output, header));
         } else {
@@ -0,0 +1,84 @@
+#include "main.h"
+#include "../Modules/kmeansNANI/KmeansEngine.h"
+#include "../Modules/kmeansNANI/MiniBatch.h"
+#include "../Modules/kmeansNANI/KmeansModel.h"
+
+int main(int argc, char const *argv[])
+{
+    char file[] = "examples/backbone.npy";
+    uword n_clusters = 8;
+    uword n_iter = 100;
+    int test_count = 3;
+
+    Algorithm algorithms[test_count] = {Algorithm::LLOYD, Algorithm::HAMERLY, Algorithm::ELKAN};
+    Matrix matrix = loadNPYFile(file);
+    vector norms = RowSquaredNorms(matrix);
+
+    arma::arma_rng::set_seed(42);
+    Matrix init = matrix.rows(arma::randperm(matrix.n_rows, n_clusters));
+
+    kmeans_result results[test_count];
+
+    for (int i = 0; i < test_count; i++)
+    {
+        double start = omp_get_wtime();
+        results[i] = RunKmeans(matrix, norms, init, n_iter, 1e-4, algorithms[i]);
+        double elapsed = omp_get_wtime() - start;
+
+        printf("%s: %llu iterations, inertia %.6f, %.4f s\n", toStr(algorithms[i]).c_str(),
+               results[i].n_iter, results[i].inertia, elapsed);
+    }
+
+    // Accelerated engines must match Lloyd's assignments
+    for (int i = 1; i < test_count; i++)
+    {
+        uword mismatches = arma::accu(results[i].labels != results[0].labels);
+        printf("%s vs lloyd: %llu label mismatches, max centroid difference %.6e\n",
+               toStr(algorithms[i]).c_str(), mismatches,
+               arma::abs(results[i].centroids - results[0].centroids).max());
+    }
+
+    // Tiled pairwise distances must match the direct row distances, with a budget small enough for many tiles
+    arma::mat sample = arma::conv_to<arma::mat>::from(matrix.rows(0, std::min<uword>(2999, matrix.n_rows - 1)));
+    arma::mat pairwise = PairwiseDistances(sample, sample, false, 1024 * 1024);
+    double max_diff = 0;
+    for (uword i = 0; i < sample.n_rows; i += 97)
+    {
+        arma::vec direct = RowDistances(sample, arma::rowvec(sample.row(i)));
+        max_diff = std::max(max_diff, arma::abs(pairwise.row(i).t() - direct).max());
+    }
+    printf("Pairwise distances: %llu x %llu, max difference to direct %.6e\n",
+           pairwise.n_rows, pairwise.n_cols, max_diff);
+
+    // Selected rows are never drawn again, even when most of the dataset is selected
+    uword n_many = std::min<uword>(matrix.n_rows / 2, 500);
+    index_vec greedy = GreedyKmeansPlusPlus(matrix, n_many);
+    index_vec parallel = KmeansParallel(matrix, n_many);
+    printf("k-means++ selections of %llu rows are distinct: greedy %s, parallel %s\n", n_many,
+           (arma::unique(greedy).eval().n_elem == n_many) ? "true" : "false",
+           (arma::unique(parallel).eval().n_elem == n_many) ? "true" : "false");
+
+    // Chunked reads must match the in-memory matrix
+    NPYChunkReader reader(file);
+    Matrix head = reader.ReadRows(0, std::min<uword>(99, reader.n_rows() - 1));
+    printf("Chunk reader: %llu x %llu, first chunk matches: %s\n", reader.n_rows(), reader.n_cols(),
+           arma::approx_equal(head, matrix.rows(0, head.n_rows - 1), "absdiff", 1e-6) ? "true" : "false");
+
+    // Mini-batch from the same start, streamed from the file
+    double start = omp_get_wtime();
+    kmeans_result mini = MiniBatchKmeans(reader, init, 256, n_iter);
+    double elapsed = omp_get_wtime() - start;
+    printf("minibatch: %llu steps, inertia %.6f (%.4f of lloyd), %.4f s\n", mini.n_iter, mini.inertia,
+           mini.inertia / results[0].inertia, elapsed);
+
+    // Streaming prediction from the file must match the in-memory labels of the fitted centroids
+    KmeansModel model(results[0].centroids);
+    index_vec streamed(reader.n_rows());
+    predict_stats predicted = model.Predict(reader, [&streamed](uword first, const index_vec &labels) {
+        streamed.subvec(first, first + labels.n_elem - 1) = labels;
+    }, 1000);
+    printf("predict: %llu frames, %.0f frames/s, labels match: %s\n", predicted.n_frames, predicted.fps(),
+           arma::all(streamed == model.Predict(matrix)) ? "true" : "false");
+
+    return 0;
+}
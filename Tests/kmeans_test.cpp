@@ -1,5 +1,6 @@
 #include "main.h"
 #include "../Modules/kmeansNANI/nani.h"
+#include "../Modules/kmeansNANI/KmeansModel.h"
 
 int main(int argc, char const *argv[])
 {
@@ -8,16 +9,23 @@ int main(int argc, char const *argv[])
     int n_atoms = 10;
     uword n_iter = 10;
     ushort percentage = 10;
-    int test_count = 3;
+    int test_count = 6;
     std::string tests[test_count] = {"****************\nRandom Initiator\n****************\n",
                                     "******************\nComp Sim Initiator\n******************\n",
-                                   "********************\nDiv Select Initiator\n********************\n"};
+                                   "********************\nDiv Select Initiator\n********************\n",
+                                   "*****************\nK-means++ Initiator\n*****************\n",
+                                   "*************************\nVanilla K-means++ Initiator\n*************************\n",
+                                   "*****************\nK-means|| Initiator\n*****************\n"};
     std::string rc = "output/backbone/random_centroids.csv";
     std::string csc = "output/backbone/comp_sim_centroids.csv";
     std::string dsc = "output/backbone/div_sel_centroids.csv";
-    std::string filenames[test_count] = {rc, csc, dsc};
+    std::string kpc = "output/backbone/kmeans_centroids.csv";
+    std::string vkc = "output/backbone/vanilla_kmeans_centroids.csv";
+    std::string kpar = "output/backbone/kmeans_parallel_centroids.csv";
+    std::string filenames[test_count] = {rc, csc, dsc, kpc, vkc, kpar};
 
-    Initiator initiators[test_count] = {Initiator::RANDOM, Initiator::COMP_SIM, Initiator::DIV_SELECT};
+    Initiator initiators[test_count] = {Initiator::RANDOM, Initiator::COMP_SIM, Initiator::DIV_SELECT,
+                                        Initiator::KMEANS, Initiator::VANILLA_KMEANS, Initiator::KMEANS_PARALLEL};
     Metric metric = Metric::MSD;
     Matrix matrix = loadNPYFile(file);
 
@@ -43,8 +51,170 @@ int main(int argc, char const *argv[])
             list(i).t().brief_print();
         }
 
+        // Counting sort grouping must match a find per cluster
+        bool grouping_matches = true;
+        for (uword c = 0; c < list.n_elem; c++)
+        {
+            index_vec expected = arma::find(data.labels == c);
+            grouping_matches &= (expected.n_elem == list(c).n_elem) && arma::all(expected == list(c));
+        }
+        printf("Cluster list matches find: %s\n", grouping_matches ? "true" : "false");
+
+        // Per-cluster MSD from the clustering statistics must match the sliced clusters
+        vector cluster_msd = data.ClusterMSD(metric, n_atoms);
+        float max_msd_diff = 0;
+        for (uword c = 0; c < list.n_elem; c++)
+        {
+            if (list(c).n_elem == 0) {continue;}
+            float sliced = ExtendedComparison(Matrix(matrix.rows(list(c))), metric, 0, n_atoms);
+            max_msd_diff = std::max(max_msd_diff, std::abs(sliced - cluster_msd(c)));
+        }
+        printf("Cluster MSD max difference: %.6f\n", max_msd_diff);
+
+        // Clusters are contiguous blocks of the permuted data
+        cluster_permutation permutation = ClusterPermutation(data.labels, n_clusters);
+        Matrix permuted = PermuteRows(matrix, permutation.order);
+        bool blocks_match = true;
+        for (uword c = 0; c < permutation.n_clusters(); c++)
+        {
+            if (permutation.size(c) == 0) {continue;}
+            Matrix block = permuted.rows(permutation.offsets(c), permutation.offsets(c + 1) - 1);
+            blocks_match &= arma::approx_equal(block, Matrix(matrix.rows(list(c))), "absdiff", 0);
+        }
+        Matrix in_place = matrix;
+        PermuteRowsInPlace(in_place, permutation.order);
+        printf("Permuted blocks match clusters: %s, in place matches copy: %s, inverse restores: %s\n",
+               blocks_match ? "true" : "false",
+               arma::approx_equal(in_place, permuted, "absdiff", 0) ? "true" : "false",
+               arma::approx_equal(PermuteRows(permuted, permutation.inverse), matrix, "absdiff", 0) ? "true" : "false");
+
         kmn.WriteCentroids(data.centers, filenames[i]);
     }
 
+    // Restarts of a stochastic initiator keep the lowest inertia
+    std::cout << "********\nRestarts\n********\n";
+    KmeansNANI restarts(matrix, n_clusters, metric, n_atoms, Initiator::KMEANS, n_iter, percentage);
+    restarts.n_init = 5;
+    cluster_data best = restarts.KmeansClustering();
+    best.restart_inertia.t().print("Restart inertia:");
+    printf("Best inertia: %.6f, is minimum: %s\n", best.inertia,
+           (best.inertia == best.restart_inertia.min()) ? "true" : "false");
+
+    // Binary model round trip
+    std::cout << "*****\nModel\n*****\n";
+    restarts.WriteModel(best, "output/backbone/kmeans_model.bin");
+    KmeansModel model = KmeansModel::Load("output/backbone/kmeans_model.bin");
+    printf("Model: %llu clusters, CH %.6f, DB %.6f, data hash matches: %s\n", model.n_clusters(),
+           model.info.fit_scores.ch, model.info.fit_scores.db,
+           (model.info.data_hash == DataHash(matrix)) ? "true" : "false");
+    printf("Centroids match: %s, labels match: %s, stats match: %s\n",
+           arma::approx_equal(model.Centroids(), Matrix(best.centers.t()), "absdiff", 0) ? "true" : "false",
+           arma::all(model.Labels() == best.labels) ? "true" : "false",
+           arma::approx_equal(model.Stats().sums, best.stats.sums, "absdiff", 0) ? "true" : "false");
+
+    // Incremental update after the trajectory grows by 20%
+    std::cout << "******************\nIncremental update\n******************\n";
+    uword n_fitted = matrix.n_rows * 4 / 5;
+    KmeansNANI partial(Matrix(matrix.rows(0, n_fitted - 1)), n_clusters, metric, n_atoms, Initiator::COMP_SIM, n_iter, percentage);
+    cluster_data partial_data = partial.KmeansClustering();
+    KmeansModel growing(partial_data, partial.ModelInfo(partial_data));
+    update_result update = growing.Update(matrix);
+    printf("Update: %llu new frames, drift %.4f, reinitialized: %s, %llu iterations, inertia %.6f\n",
+           update.n_new, update.drift, update.reinitialized ? "true" : "false", update.n_iter, update.inertia);
+    printf("Labels cover the trajectory: %s, counts match: %s, data hash matches: %s\n",
+           (growing.Labels().n_elem == matrix.n_rows) ? "true" : "false",
+           (arma::accu(growing.Stats().counts) == matrix.n_rows) ? "true" : "false",
+           (growing.info.data_hash == DataHash(matrix)) ? "true" : "false");
+
+    // Frames drawn from the fitted distribution are merged, shifted frames trigger a refit
+    Matrix shuffled = matrix.rows(arma::randperm(matrix.n_rows));
+    KmeansNANI sampled(Matrix(shuffled.rows(0, n_fitted - 1)), n_clusters, metric, n_atoms, Initiator::COMP_SIM, n_iter, percentage);
+    cluster_data sampled_data = sampled.KmeansClustering();
+    KmeansModel in_distribution(sampled_data, sampled.ModelInfo(sampled_data));
+    KmeansModel shifted_model = in_distribution;
+    update_result merged = in_distribution.Update(shuffled);
+    Matrix shifted = shuffled;
+    shifted.rows(n_fitted, matrix.n_rows - 1) += 10.0f * std::sqrt(sampled_data.inertia / n_fitted / matrix.n_cols);
+    update_result refit = shifted_model.Update(shifted);
+    printf("In-distribution append: drift %.4f, reinitialized: %s; shifted append: drift %.4f, reinitialized: %s\n",
+           merged.drift, merged.reinitialized ? "true" : "false", refit.drift, refit.reinitialized ? "true" : "false");
+
+    // Weighted frames match the expanded trajectory, the first quarter is doubled
+    std::cout << "***************\nWeighted frames\n***************\n";
+    uword n_doubled = matrix.n_rows / 4;
+    Matrix expanded = arma::join_cols(matrix, Matrix(matrix.rows(0, n_doubled - 1)));
+    arma::dvec frame_weights(matrix.n_rows, arma::fill::ones);
+    frame_weights.head(n_doubled).fill(2);
+    printf("MSD: weighted %.6f, expanded %.6f\n",
+           MeanSquareDeviation(matrix, frame_weights, n_atoms), MeanSquareDeviation(expanded, n_atoms));
+    printf("Medoid: weighted %i, expanded %i\n", CalculateMedoid(matrix, frame_weights, metric, n_atoms),
+           CalculateMedoid(expanded, metric, n_atoms) % (int)matrix.n_rows);
+
+    Matrix init_centroids = matrix.rows(DiversitySelection(matrix, frame_weights, percentage, metric).head(n_clusters));
+    KmeansNANI weighted(matrix, n_clusters, metric, n_atoms, Initiator::COMP_SIM, n_iter, percentage);
+    weighted.setWeights(frame_weights);
+    KmeansNANI full(expanded, n_clusters, metric, n_atoms, Initiator::COMP_SIM, n_iter, percentage);
+    cluster_data weighted_data = weighted.KmeansClustering(init_centroids);
+    cluster_data full_data = full.KmeansClustering(init_centroids);
+    printf("Inertia: weighted %.6f, expanded %.6f, centroids match: %s\n", weighted_data.inertia, full_data.inertia,
+           arma::approx_equal(weighted_data.centers, full_data.centers, "reldiff", 1e-4) ? "true" : "false");
+    vector weighted_msd = weighted_data.ClusterMSD(metric, n_atoms);
+    vector full_msd = full_data.ClusterMSD(metric, n_atoms);
+    printf("Cluster MSD: weighted matches expanded: %s\n",
+           arma::approx_equal(weighted_msd, full_msd, "reldiff", 1e-4) ? "true" : "false");
+    scores weighted_scores = ComputeDataScores(matrix, weighted_data.labels, n_clusters, frame_weights, SILHOUETTE_EXACT);
+    scores full_scores = ComputeDataScores(expanded, full_data.labels, n_clusters, SILHOUETTE_EXACT);
+    printf("Scores: weighted CH %.6f DB %.6f, expanded CH %.6f DB %.6f\n",
+           weighted_scores.ch, weighted_scores.db, full_scores.ch, full_scores.db);
+
+    // Near-duplicate frames clustered as weighted representatives
+    std::cout << "*****************\nFrame compression\n*****************\n";
+    float radius = 0.5f * MeanSquareDeviation(Matrix(matrix.rows(0, 9)), n_atoms);
+    compressed_frames compressed = CompressFrames(matrix, radius, n_atoms);
+    printf("Compression: %llu frames to %llu representatives (%.2fx), weights sum: %.0f\n",
+           compressed.n_frames(), compressed.n_representatives(), compressed.ratio(), arma::accu(compressed.weights));
+    bool within_radius = true;
+    for (uword i = 0; i < matrix.n_rows; i++) {
+        Matrix pair = arma::join_cols(matrix.row(i), compressed.frames.row(compressed.map(i)));
+        within_radius &= (MeanSquareDeviation(pair, n_atoms) <= radius * (1 + 1e-4));
+    }
+    printf("Frames within radius of their representative: %s\n", within_radius ? "true" : "false");
+    if (compressed.n_representatives() > (uword)n_clusters) {
+        KmeansNANI reduced(compressed.frames, n_clusters, metric, n_atoms, Initiator::KMEANS, n_iter, percentage);
+        reduced.setWeights(compressed.weights);
+        index_vec frame_labels = compressed.ExpandLabels(reduced.KmeansClustering().labels);
+        printf("Expanded labels: %llu\n", frame_labels.n_elem);
+    }
+
+    // Coreset cost matches the full cost, within the Bernstein bound for centroids fitted on the full data
+    std::cout << "*******\nCoreset\n*******\n";
+    coreset core = BuildCoreset(matrix, matrix.n_rows / 5, 42);
+    printf("Coreset: %llu rows from %llu draws, weights sum %.2f (n_samples %llu), medoid %llu\n",
+           core.size(), core.n_draws, arma::accu(core.weights), core.n_samples, core.medoid);
+    auto full_cost = [&matrix](const Matrix &centroids) {
+        vector distances;
+        AssignLabels(matrix, RowSquaredNorms(matrix), centroids, distances);
+        return arma::accu(arma::conv_to<arma::dvec>::from(distances));
+    };
+    Matrix fixed_centroids = best.centers.t();
+    double fixed_cost = full_cost(fixed_centroids);
+    double fixed_estimate = CoresetCost(core, fixed_centroids);
+    double fixed_bound = CoresetErrorBound(core, fixed_centroids);
+    printf("Full cost %.6f, coreset cost %.6f, bound %.6f, within the bound: %s, within 5%%: %s\n",
+           fixed_cost, fixed_estimate, fixed_bound, (std::abs(fixed_estimate - fixed_cost) <= fixed_bound) ? "true" : "false",
+           (std::abs(fixed_estimate - fixed_cost) <= 0.05 * fixed_cost) ? "true" : "false");
+
+    // Clustering found on the coreset
+    MatrixSource source(matrix);
+    cluster_data core_data = CoresetNANI(source, n_clusters, metric, n_atoms, Initiator::COMP_SIM,
+                                         matrix.n_rows / 5, n_iter, percentage, true, 42);
+    Matrix core_centroids = core_data.centers.t();
+    double core_full_cost = full_cost(core_centroids);
+    double core_cost = CoresetCost(core, core_centroids);
+    double relative_error = std::abs(core_cost - core_full_cost) / core_full_cost;
+    printf("CoresetNANI: full cost %.6f, coreset cost %.6f, relative error %.4f, within 5%%: %s, labels: %llu\n",
+           core_full_cost, core_cost, relative_error, (relative_error <= 0.05) ? "true" : "false",
+           core_data.labels.n_elem);
+
     return 0;
 }
@@ -238,6 +238,16 @@ int main(int argc, char *argv[]) {
     printf("\n");
 
 
+    // Diversity Selection warm start from the first half of the medoid selection
+    printf("Diversity Selection + NewIndex (LIST warm start)\n");
+    for (long unsigned int i = 0; i < ds_results.size(); i++) {
+        index_vec prefix = ds_results[i].head(ds_results[i].n_elem / 2);
+        index_vec resumed = DiversitySelection(matrix, percentage, metrics[i], DiversitySeed::LIST, n_atoms, prefix);
+        printf("Metric \'%s\': %s\n", toStr(metrics[i]).c_str(),
+               arma::all(resumed == ds_results[i]) ? "matches" : "differs");
+    }
+    printf("\n");
+
     // Diversity Selection Outlier Results
     // OutputResults<DiversitySeed>("DiversitySelection + NewIndex (OUTLIER)", matrix, metrics,
     // percentage, n_atoms, DiversitySeed::OUTLIER, DiversitySelection);
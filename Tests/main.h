@@ -15,6 +15,7 @@
 #include "../Tools/BTS/Outlier.h"
 #include "../Tools/BTS/DiversitySelection.h"
 #include "../Tools/BTS/NewIndex.h"
+#include "../Tools/BTS/FrameCompression.h"
 #include "../FileIO/ReadNPY.h"
 
 void OutputResults(
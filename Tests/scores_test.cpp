@@ -0,0 +1,38 @@
+#include "main.h"
+#include "../Modules/kmeansNANI/nani.h"
+
+int main(int argc, char const *argv[])
+{
+    // sklearn documentation example
+    Matrix X = {{0, 1}, {1, 1}, {3, 4}};
+    index_vec labels = {0, 0, 1};
+    Matrix centers = {{0.5, 3}, {1, 4}};
+
+    cluster_indices clusters = CreateClusterList(labels, 2);
+    scores results = ComputeDataScores(X, centers, clusters);
+
+    // davies_bouldin_score(X, labels) = 0.1280..., calinski_harabasz_score(X, labels) = 20.333...
+    printf("Davies-Bouldin: %.6f (expected 0.128037)\n", results.db);
+    printf("Calinski-Harabasz: %.6f (expected 20.333333)\n", results.ch);
+
+    // Same scores from the labels and the cluster statistics
+    scores label_results = ComputeDataScores(X, labels, 2, SILHOUETTE_EXACT);
+    cluster_stats stats = ClusterStatistics(X, labels, 2);
+    printf("Label scores: DB %.6f, CH %.6f\n", label_results.db, label_results.ch);
+
+    // silhouette_score(X, labels) = 0.4956...
+    printf("Silhouette: %.6f (expected 0.495649)\n", label_results.sil);
+    printf("Silhouette (exact): %.6f\n", SilhouetteScore(X, labels, 2));
+    printf("Cluster WCSS: %.6f %.6f (expected 0.500000 0.000000)\n", ClusterWCSS(stats)(0), ClusterWCSS(stats)(1));
+
+    // Weighted samples give the scores of the expanded dataset [[0, 1], [1, 1], [3, 4], [3, 4]]
+    Matrix expanded = {{0, 1}, {1, 1}, {3, 4}, {3, 4}};
+    index_vec expanded_labels = {0, 0, 1, 1};
+    arma::dvec weights = {1, 1, 2};
+    scores weighted = ComputeDataScores(X, labels, 2, weights, SILHOUETTE_EXACT);
+    scores full = ComputeDataScores(expanded, expanded_labels, 2, SILHOUETTE_EXACT);
+    printf("Weighted: DB %.6f, CH %.6f, silhouette %.6f\n", weighted.db, weighted.ch, weighted.sil);
+    printf("Expanded: DB %.6f, CH %.6f, silhouette %.6f\n", full.db, full.ch, full.sil);
+
+    return 0;
+}
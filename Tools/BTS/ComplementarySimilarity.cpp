@@ -46,6 +46,74 @@ vector CalculateCompSim(Matrix matrix, Metric metric, int n_atoms){
 }
 
 
+/*
+Complementary similarity of a weighted dataset, where row i stands for 
+weights(i) identical objects (e.g. a deduplicated frame and its multiplicity). 
+The complement of object i removes a single copy of it, so the result is 
+the complementary similarity of any of its copies in the full dataset.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row. Rows with a weight below 1 are removed entirely.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+
+Returns
+-------
+vector
+    Complementary similarity of each object.
+*/
+vector CalculateCompSim(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms)
+{
+    uword N = matrix.n_rows;
+    double W = arma::accu(weights);
+
+    rvector c_sum_total, sq_sum_total;
+    WeightedColumnSums(matrix, weights, c_sum_total, sq_sum_total);
+
+    vector values(N);
+
+    if (metric == Metric::MSD) {
+        // MSD of the complement from the totals, in double precision
+        arma::drowvec c = arma::conv_to<arma::drowvec>::from(c_sum_total);
+        double c_norm = arma::dot(c, c);
+        double sq_total = arma::accu(arma::conv_to<arma::drowvec>::from(sq_sum_total));
+
+        #pragma omp parallel for schedule(static)
+        for (uword i = 0; i < N; i++) {
+            double r = std::min(weights(i), 1.0);
+            double n = W - r;
+            if (n <= 0) {values(i) = 0; continue;}
+            double x_norm = 0.0;
+            double c_x = 0.0;
+            for (uword j = 0; j < matrix.n_cols; j++) {
+                double x = matrix(i, j);
+                x_norm += x * x;
+                c_x += c(j) * x;
+            }
+            double comp_sq = sq_total - r * x_norm;
+            double comp_c = c_norm - 2 * r * c_x + r * r * x_norm;
+            values(i) = 2 * (n * comp_sq - comp_c) / (n * n * n_atoms);
+        }
+        return values;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (uword i = 0; i < N; i++) {
+        double r = std::min(weights(i), 1.0);
+        rvector diff = c_sum_total - (float)r * matrix.row(i);
+        values(i) = ExtendedComparison(diff, metric, (int)std::llround(W - r), n_atoms);
+    }
+
+    return values;
+}
+
+
 // Simplified complementary similarity calculation if metric is MSD
 vector CSimMSD(Matrix matrix, int n_atoms){
     int N = matrix.n_rows;
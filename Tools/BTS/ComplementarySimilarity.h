@@ -8,6 +8,10 @@
 // The greater the complementary similarity, the more representative the object is.
 vector CalculateCompSim(Matrix matrix, Metric metric, int n_atoms = 1);
 
+// Complementary similarity of a dataset whose rows count weights(i) times,
+// each object is removed once from its own set.
+vector CalculateCompSim(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms = 1);
+
 // Simplified complementary similarity calculation if metric is MSD
 vector CSimMSD(Matrix matrix, int n_atoms = 1);
 
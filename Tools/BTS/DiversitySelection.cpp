@@ -10,10 +10,14 @@ percentage : int
     Percentage of the data to select.
 metric : {'MSD', 'RR', 'JT', 'SM', etc}
     Metric used for extended comparisons. See `extended_comparison` for details.
-start : {'medoid', 'outlier', 'random'}, optional
+start : {'medoid', 'outlier', 'random', 'list'}, optional
     Seed of diversity selection. Defaults to 'medoid'.
+    'list' resumes the selection from the indices in seed_list.
 N_atoms : int, optional
     Number of atoms in the system. Defaults to 1.
+seed_list : index_vec, optional
+    Initial indices used when start is 'list' (e.g. a previous selection
+    or known reference structures). Ignored for other seeds.
 
 Returns
 -------
@@ -21,8 +25,8 @@ list
     List of indices of the selected data.
 */
 index_vec DiversitySelection(
-    Matrix matrix, int percentage, Metric metric,
-    DiversitySeed start, int n_atoms)
+    const Matrix &matrix, int percentage, Metric metric,
+    DiversitySeed start, int n_atoms, const index_vec &seed_list)
 {
     index_vec selected_n(1);
     uword n_total = matrix.n_rows;
@@ -30,11 +34,20 @@ index_vec DiversitySelection(
 
     switch (start)
     {
+    case DiversitySeed::LIST:
+        if (!seed_list.is_empty()) {
+            return DiversitySelection(matrix, percentage, metric, seed_list, n_atoms);
+        }
+        fprintf(stderr, "Empty seed list for diversity selection, defaulting to medoid\n");
+        seed = CalculateMedoid(matrix, metric, n_atoms);
+        break;
     case DiversitySeed::OUTLIER:
         seed = CalculateOutlier(matrix, metric, n_atoms);
         break;
     case DiversitySeed::RANDOM:
         seed = rand() % n_total;
+        break;
+    case DiversitySeed::MEDOID:
     default:
         seed = CalculateMedoid(matrix, metric, n_atoms);
         break;
@@ -58,6 +71,9 @@ index_vec DiversitySelection(
 
 /* Selects a diverse subset of the data using the complementary similarity.
 
+The greedy selection is prefix-consistent, so passing a previous selection
+as start resumes the extension where it stopped instead of recomputing it.
+
 Parameters
 ----------
 matrix : Matrix
@@ -66,7 +82,7 @@ percentage : int
     Percentage of the data to select.
 metric : {'MSD', 'RR', 'JT', 'SM', etc}
     Metric used for extended comparisons. See `extended_comparison` for details.
-start : std::vector<int>
+start : index_vec
     Seed vector of diversity selection.
 N_atoms : int, optional
     Number of atoms in the system. Defaults to 1.
@@ -74,42 +90,146 @@ N_atoms : int, optional
 Returns
 -------
 list
-    List of indices of the selected data.
+    List of indices of the selected data, starting with the seeds.
 */
 index_vec DiversitySelection(
-    Matrix matrix, int percentage, Metric metric,
+    const Matrix &matrix, int percentage, Metric metric,
+    index_vec start, int n_atoms)
+{
+    uword n_total = matrix.n_rows;
+    uword n_max = (uword)floor(n_total * percentage / 100);
+
+    if (n_max > n_total){n_max = n_total;}
+
+    return DiversitySelectionN(matrix, n_max, metric, start, n_atoms);
+}
+
+/* Selects a diverse subset of a weighted dataset, where row i stands for 
+weights(i) identical objects.
+
+Copies of a selected object add nothing to the diversity of the selection, 
+so only the seed (weighted medoid or outlier) and the number of selected 
+objects depend on the weights, and the greedy selection runs on the rows.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row.
+percentage : int
+    Percentage of the total weight to select, capped at the number of rows.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+start : {'medoid', 'outlier', 'random'}, optional
+    Seed of diversity selection. Defaults to 'medoid'.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+
+Returns
+-------
+index_vec
+    Indices of the selected rows in selection order.
+*/
+index_vec DiversitySelection(
+    const Matrix &matrix, const arma::dvec &weights, int percentage, Metric metric,
+    DiversitySeed start, int n_atoms)
+{
+    if (weights.n_elem != matrix.n_rows) {
+        throw std::invalid_argument("The number of weights does not match the number of rows.\n");
+    }
+
+    uword n_total = matrix.n_rows;
+    index_vec selected_n(1);
+
+    switch (start)
+    {
+    case DiversitySeed::OUTLIER:
+        selected_n(0) = CalculateOutlier(matrix, weights, metric, n_atoms);
+        break;
+    case DiversitySeed::RANDOM:
+        selected_n(0) = rand() % n_total;
+        break;
+    case DiversitySeed::LIST:
+        fprintf(stderr, "Seed lists are not supported for weighted diversity selection, defaulting to medoid\n");
+        selected_n(0) = CalculateMedoid(matrix, weights, metric, n_atoms);
+        break;
+    case DiversitySeed::MEDOID:
+    default:
+        selected_n(0) = CalculateMedoid(matrix, weights, metric, n_atoms);
+        break;
+    }
+
+    uword n_max = (uword)floor(arma::accu(weights) * percentage / 100);
+
+    return DiversitySelectionN(matrix, n_max, metric, selected_n, n_atoms);
+}
+
+/* Selects the first n_max objects of the greedy diverse ordering.
+
+Each new object only depends on the ones selected before it, so the first
+k entries of a run with n_max >= k are exactly the result of a run with
+n_max = k. Callers that only need a few objects (e.g. initial k-means
+centers) can stop early, and a shorter selection can later be extended by
+passing it back as start.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+n_max : uword
+    Number of objects to select (including the seeds), capped at the number of rows.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+start : index_vec
+    Seed vector of diversity selection.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+
+Returns
+-------
+index_vec
+    Indices of the selected data in selection order, starting with the seeds.
+*/
+index_vec DiversitySelectionN(
+    const Matrix &matrix, uword n_max, Metric metric,
     index_vec start, int n_atoms)
 {   
     // Variable declarations 
-    index_vec selected_n = start;
+    uword n_total = matrix.n_rows;
+    index_vec selected_n = ValidateSeeds(start, n_total);
     uword new_index_n;
     rvector sq_selection_condensed;
-    uword n_total = matrix.n_rows;
     uword prev_size;
-    index_vec total_indices = arma::regspace<index_vec>(0, n_total-1);
 
     uword N = selected_n.size(); 
-    uword n_max = (uword)floor(n_total * percentage / 100);
 
     if (n_max > n_total){n_max = n_total;}
 
-    Matrix selection(selected_n.size(), matrix.n_cols, arma::fill::zeros);
-
-    for (long unsigned int i = 0; i < selected_n.size(); i++) {
-        selection.row(i) = matrix.row(selected_n[i]);
+    if (selected_n.is_empty() || N >= n_max) {
+        return selected_n;
     }
 
+    Matrix selection = matrix.rows(selected_n);
+
     rvector selected_condensed = arma::sum(selection,COL);
 
     if (metric == Metric::MSD) {
             sq_selection_condensed = arma::sum(arma::pow(selection,2),COL);
     }
-    while (selected_n.size() < n_max){
-        //select_from_n = np.delete(total_indices, selected_n)
-        //Removing rows each time leads to issues 
-        index_vec select_from_n(total_indices);
-        select_from_n.shed_rows(selected_n); 
 
+    // Indices that have not been selected yet, kept in ascending order
+    std::vector<bool> is_selected(n_total, false);
+    for (uword i : selected_n) {is_selected[i] = true;}
+
+    index_vec select_from_n(n_total - N);
+    for (uword i = 0, j = 0; i < n_total; i++) {
+        if (!is_selected[i]) {select_from_n(j++) = i;}
+    }
+
+    selected_n.resize(n_max);
+
+    while (N < n_max){
         if (metric == Metric::MSD){
             // new_index_n = get_new_index_n(matrix, metric=metric, selected_condensed,
             //                               sq_selected_condensed, N, 
@@ -117,9 +237,6 @@ index_vec DiversitySelection(
             new_index_n = GetNewIndexN(
                 matrix, metric, selected_condensed, 
                 sq_selection_condensed, N, select_from_n, n_atoms);
-
-            // sq_selected_condensed += matrix[new_index_n] ** 2
-            sq_selection_condensed = sq_selection_condensed + pow(matrix.row(new_index_n), 2);
         } else {
             // new_index_n = get_new_index_n(matrix, metric, selected_condensed, 
             //                               N, select_from_n)
@@ -128,18 +245,65 @@ index_vec DiversitySelection(
                 N, select_from_n, n_atoms);
 
         }
+        if (new_index_n >= n_total) {
+            fprintf(stderr, "No valid index found for metric %s, stopping selection at %llu\n",
+                    toStr(metric).c_str(), N);
+            selected_n.resize(N);
+            break;
+        }
+        if (metric == Metric::MSD) {
+            // sq_selected_condensed += matrix[new_index_n] ** 2
+            sq_selection_condensed += arma::pow(matrix.row(new_index_n), 2);
+        }
         // selected_condensed += matrix[new_index_n]
-        selected_condensed = selected_condensed + matrix.row(new_index_n);
+        selected_condensed += matrix.row(new_index_n);
 
         // selected_n.append(new_index_n)
-        prev_size = selected_n.size();
-        selected_n.resize(prev_size+1);
+        prev_size = N;
         selected_n(prev_size) = new_index_n;
 
+        // Remove the new index from the candidates without rebuilding the list
+        index_vec position = arma::find(select_from_n == new_index_n, 1);
+        select_from_n.shed_row(position(0));
+
         // n = len(selected_n)
-        N = selected_n.size();
+        N = prev_size + 1;
     }
 
-    
     return selected_n;
-}
\ No newline at end of file
+}
+
+/* Validates a list of seed indices for diversity selection.
+
+Parameters
+----------
+seeds : index_vec
+    Candidate seed indices.
+n_total : uword
+    Number of objects in the dataset.
+
+Returns
+-------
+index_vec
+    Seeds in their original order with out of range and repeated indices removed.
+*/
+index_vec ValidateSeeds(const index_vec &seeds, uword n_total)
+{
+    std::vector<bool> seen(n_total, false);
+    index_vec valid(seeds.n_elem);
+    uword n_valid = 0;
+
+    for (uword seed : seeds) {
+        if (seed >= n_total) {
+            fprintf(stderr, "Seed index %llu is out of range [%i, %llu), ignoring\n",
+                    seed, 0, n_total);
+            continue;
+        }
+        if (seen[seed]) {continue;}
+        seen[seed] = true;
+        valid(n_valid++) = seed;
+    }
+
+    valid.resize(n_valid);
+    return valid;
+}
@@ -6,13 +6,29 @@
 #include "NewIndex.h"
 
 // Selects a diverse subset of the data using the complementary similarity.
+// If start is DiversitySeed::LIST, selection resumes from seed_list.
 index_vec DiversitySelection(
-    Matrix matrix, int percentage, Metric metric,
-    DiversitySeed start = DiversitySeed::MEDOID, int n_atoms = 1);
+    const Matrix &matrix, int percentage, Metric metric,
+    DiversitySeed start = DiversitySeed::MEDOID, int n_atoms = 1,
+    const index_vec &seed_list = index_vec());
 
 // Selects a diverse subset of the data using the complementary similarity.
 index_vec DiversitySelection(
-    Matrix matrix, int percentage, Metric metric,
+    const Matrix &matrix, int percentage, Metric metric,
     index_vec start, int n_atoms = 1);
+
+// Diversity selection of a dataset whose rows count weights(i) times, the seed and the
+// number of selected objects follow the weights and each row is selected at most once.
+index_vec DiversitySelection(
+    const Matrix &matrix, const arma::dvec &weights, int percentage, Metric metric,
+    DiversitySeed start = DiversitySeed::MEDOID, int n_atoms = 1);
+
+// Selects the first n_max objects of the greedy diverse ordering, resuming from start.
+index_vec DiversitySelectionN(
+    const Matrix &matrix, uword n_max, Metric metric,
+    index_vec start, int n_atoms = 1);
+
+// Validates a list of seed indices, dropping out of range and repeated entries.
+index_vec ValidateSeeds(const index_vec &seeds, uword n_total);
     
-#endif // !DIVERSITY_SELECTION_H
\ No newline at end of file
+#endif // !DIVERSITY_SELECTION_H
@@ -0,0 +1,160 @@
+#include "FrameCompression.h"
+
+/*
+Squared distance between two frames, stops once the threshold is exceeded.
+*/
+static inline double BoundedDistance(const float *x, const float *y, uword M, double threshold)
+{
+    double sum = 0.0;
+    for (uword j = 0; j < M; j++) {
+        double d = x[j] - y[j];
+        sum += d * d;
+        // Checked every few features, most non-matching frames stop early
+        if (((j & 63) == 63) && (sum > threshold)) {return sum;}
+    }
+    return sum;
+}
+
+/*
+Hash (FNV-1a) of the grid cell of a frame.
+*/
+static inline unsigned long long CellKey(const float *x, uword M, float grid_size)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (uword j = 0; j < M; j++) {
+        long long cell = (long long)std::floor(x[j] / grid_size);
+        hash = (hash ^ (unsigned long long)cell) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+Compresses near-duplicate frames (e.g. consecutive MD frames at fine time
+steps) into weighted representatives, in a single streaming pass.
+
+Frames are read chunk_size at a time. Each frame is compared with the
+running representative (the representative of the previous frame) and joins
+it if the MSD of the pair [frame, representative] is within the radius,
+otherwise it becomes a new representative. With grid_size > 0, the
+representatives are also bucketed by a hash of their grid cell, and a frame
+that does not match the running representative is compared with the
+representatives of its own cell, so frames that revisit an earlier
+conformation are merged as well.
+
+The MSD of a pair is |x - r|^2 / (2 n_atoms) (see MeanSquareDeviation), so a
+frame is merged when |x - r|^2 <= 2 n_atoms radius. Representatives are
+actual frames, and the weights, rows and map (frame -> representative) let
+the reduced set be clustered weighted (KmeansNANI::weights, DiversitySelection)
+and the labels be expanded back to every frame.
+
+Parameters
+----------
+source : ChunkSource
+    Input frames (n_frames, n_features), e.g. a NPYChunkReader.
+radius : float
+    Largest MSD between a frame and its representative.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+grid_size : float, optional
+    Spacing of the coordinate grid used to bucket the representatives, 0 to
+    only compare with the running representative. Defaults to 0.
+chunk_size : uword, optional
+    Number of frames read per chunk. Defaults to COMPRESSION_CHUNK_SIZE.
+
+Returns
+-------
+compressed_frames
+    Representative frames, their weights and original rows, and the
+    representative of every frame.
+*/
+compressed_frames CompressFrames(
+    const ChunkSource &source, float radius, int n_atoms, float grid_size,
+    uword chunk_size)
+{
+    uword N = source.n_rows();
+    uword M = source.n_cols();
+
+    if (radius < 0) {
+        throw std::invalid_argument("The compression radius must not be negative.\n");
+    }
+    if (chunk_size == 0) {chunk_size = COMPRESSION_CHUNK_SIZE;}
+
+    double threshold = 2.0 * n_atoms * radius;
+    bool use_grid = (grid_size > 0);
+
+    // Representatives as columns, grown by doubling
+    uword capacity = std::max<uword>(std::min<uword>(N, 1024), 1);
+    Matrix representatives(M, capacity);
+    std::vector<double> weights;
+    std::vector<uword> rows;
+    std::unordered_map<unsigned long long, std::vector<uword>> buckets;
+
+    compressed_frames result;
+    result.map.set_size(N);
+
+    uword n_reps = 0;
+    uword current = 0;
+
+    for (uword first = 0; first < N; first += chunk_size) {
+        uword last = std::min(first + chunk_size, N) - 1;
+        // Frames as contiguous columns
+        Matrix chunk = source.ReadRows(first, last).t();
+
+        for (uword a = 0; a < chunk.n_cols; a++) {
+            const float *frame = chunk.colptr(a);
+            uword match = n_reps;
+
+            if ((n_reps > 0) && (BoundedDistance(frame, representatives.colptr(current), M, threshold) <= threshold)) {
+                match = current;
+            }
+
+            unsigned long long key = 0;
+            if ((match == n_reps) && use_grid) {
+                key = CellKey(frame, M, grid_size);
+                auto bucket = buckets.find(key);
+                if (bucket != buckets.end()) {
+                    for (uword r : bucket->second) {
+                        if ((r != current) && (BoundedDistance(frame, representatives.colptr(r), M, threshold) <= threshold)) {
+                            match = r;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (match == n_reps) {
+                if (n_reps == capacity) {
+                    capacity *= 2;
+                    representatives.resize(M, capacity);
+                }
+                std::copy(frame, frame + M, representatives.colptr(n_reps));
+                weights.push_back(0.0);
+                rows.push_back(first + a);
+                if (use_grid) {buckets[key].push_back(n_reps);}
+                n_reps++;
+            }
+
+            weights[match] += 1;
+            result.map(first + a) = match;
+            current = match;
+        }
+    }
+
+    result.frames = (n_reps > 0) ? Matrix(representatives.cols(0, n_reps - 1).t()) : Matrix(0, M);
+    result.weights = arma::dvec(weights);
+    result.rows = arma::conv_to<index_vec>::from(rows);
+
+    return result;
+}
+
+/*
+Compresses near-duplicate frames of an in-memory matrix. See CompressFrames
+with a ChunkSource.
+*/
+compressed_frames CompressFrames(
+    const Matrix &data, float radius, int n_atoms, float grid_size,
+    uword chunk_size)
+{
+    MatrixSource source(data);
+    return CompressFrames(source, radius, n_atoms, grid_size, chunk_size);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef FRAME_COMPRESSION_H
+#define FRAME_COMPRESSION_H
+#include <unordered_map>
+#include "BTS.h"
+
+// Number of frames read per chunk by the compression pass
+#define COMPRESSION_CHUNK_SIZE 65536
+
+// Near-duplicate frames merged into weighted representatives
+struct compressed_frames
+{
+    // Representative frames (n_representatives, n_features)
+    Matrix frames;
+    // Number of frames merged into each representative
+    arma::dvec weights;
+    // Original row of each representative
+    index_vec rows;
+    // Representative of each original frame (n_frames)
+    index_vec map;
+
+    uword n_frames() const {return map.n_elem;}
+
+    uword n_representatives() const {return frames.n_rows;}
+
+    // Number of frames per representative
+    double ratio() const {return (frames.n_rows > 0) ? (double)map.n_elem / frames.n_rows : 0.0;}
+
+    // Labels of the original frames from the labels of the representatives
+    index_vec ExpandLabels(const index_vec &labels) const {return labels.elem(map);}
+};
+
+// Greedily merges every frame within an MSD radius of a representative, in one streaming pass.
+// grid_size > 0 also buckets the representatives by their coordinates on a grid of that spacing.
+compressed_frames CompressFrames(
+    const ChunkSource &source, float radius, int n_atoms = 1, float grid_size = 0,
+    uword chunk_size = COMPRESSION_CHUNK_SIZE);
+
+// Frame compression of an in-memory matrix
+compressed_frames CompressFrames(
+    const Matrix &data, float radius, int n_atoms = 1, float grid_size = 0,
+    uword chunk_size = COMPRESSION_CHUNK_SIZE);
+
+#endif // !FRAME_COMPRESSION_H
@@ -73,4 +73,100 @@ float MSDCondensed(rvector c_sum, rvector sq_sum, int N, int n_atoms){
     // }
     // float msd = sum / pow(N,2);
     return (msd / n_atoms);
+}
+
+
+/* Weighted column sum and squared column sum of the data, each row counts 
+weights(i) times (e.g. the multiplicity of a deduplicated frame).
+
+Parameters
+----------
+matrix : Matrix
+    Data matrix.
+weights : arma::dvec
+    Weight of each row.
+c_sum : vector of size n_features
+    Output, weighted column sum.
+sq_sum : vector of size n_features
+    Output, weighted column sum of the squared data.
+*/
+void WeightedColumnSums(const Matrix &matrix, const arma::dvec &weights, rvector &c_sum, rvector &sq_sum)
+{
+    if (weights.n_elem != matrix.n_rows) {
+        throw std::invalid_argument("The number of weights does not match the number of rows.\n");
+    }
+
+    arma::drowvec c(matrix.n_cols, arma::fill::zeros);
+    arma::drowvec sq(matrix.n_cols, arma::fill::zeros);
+
+    #pragma omp parallel for schedule(static)
+    for (uword j = 0; j < matrix.n_cols; j++) {
+        const float *column = matrix.colptr(j);
+        double c_j = 0.0;
+        double sq_j = 0.0;
+        for (uword i = 0; i < matrix.n_rows; i++) {
+            double w_x = weights(i) * column[i];
+            c_j += w_x;
+            sq_j += w_x * column[i];
+        }
+        c(j) = c_j;
+        sq(j) = sq_j;
+    }
+
+    c_sum = arma::conv_to<rvector>::from(c);
+    sq_sum = arma::conv_to<rvector>::from(sq);
+}
+
+
+/* Mean square deviation (MSD) of a weighted dataset, equal to the MSD of the 
+dataset with each row repeated weights(i) times.
+
+Parameters
+----------
+matrix : Matrix
+    Data matrix.
+weights : arma::dvec
+    Weight of each row.
+N_atoms : int
+    Number of atoms in the system.
+
+Returns
+-------
+float
+    normalized MSD value.
+*/
+float MeanSquareDeviation(const Matrix &matrix, const arma::dvec &weights, int n_atoms)
+{
+    rvector c_sum, sq_sum;
+    WeightedColumnSums(matrix, weights, c_sum, sq_sum);
+    return WeightedMSDCondensed(c_sum, sq_sum, arma::accu(weights), n_atoms);
+}
+
+
+/* Condensed version of Mean square deviation (MSD) with a total weight, 
+which does not need to be an integer.
+
+Parameters
+----------
+c_sum : vector of size n_features
+    Weighted column sum of the data. 
+sq_sum : vector of size n_features
+    Weighted column sum of the squared data.
+N : double
+    Total weight of the data points.
+n_atoms : int
+    Number of atoms in the system.
+
+Returns
+-------
+float
+    normalized MSD value.
+*/
+float WeightedMSDCondensed(const rvector &c_sum, const rvector &sq_sum, double N, int n_atoms)
+{
+    if (N <= 0) {return 0.0f;}
+    arma::drowvec c = arma::conv_to<arma::drowvec>::from(c_sum);
+    arma::drowvec sq = arma::conv_to<arma::drowvec>::from(sq_sum);
+    double msd = arma::accu(2 * (N * sq - arma::square(c))) / (N * N);
+    return msd / n_atoms;
 }
\ No newline at end of file
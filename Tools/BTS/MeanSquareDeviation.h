@@ -7,4 +7,13 @@ float MeanSquareDeviation(Matrix matrix, int n_atoms);
 
 // Condensed version of Mean square deviation (MSD).
 float MSDCondensed(rvector c_sum, rvector sq_sum, int N, int n_atoms);
+
+// Weighted column sum and squared column sum, each row counts weights(i) times
+void WeightedColumnSums(const Matrix &matrix, const arma::dvec &weights, rvector &c_sum, rvector &sq_sum);
+
+// Mean square deviation of a dataset whose rows count weights(i) times
+float MeanSquareDeviation(const Matrix &matrix, const arma::dvec &weights, int n_atoms);
+
+// Condensed MSD with a (possibly fractional) total weight
+float WeightedMSDCondensed(const rvector &c_sum, const rvector &sq_sum, double N, int n_atoms);
 #endif // !MEAN_SQUARE_DEVIATION_H
\ No newline at end of file
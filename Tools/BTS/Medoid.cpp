@@ -43,4 +43,30 @@ int CalculateMedoid(Matrix matrix, Metric metric, int n_atoms){
     }
 
     return (int)index;
+}
+
+/*
+Calculates the medoid of a weighted dataset, where row i stands for weights(i) 
+identical objects. The result matches the medoid of the expanded dataset.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+
+Returns
+-------
+int
+    The index of the medoid in the dataset.
+*/
+int CalculateMedoid(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms)
+{
+    vector csim = CalculateCompSim(matrix, weights, metric, n_atoms);
+    return (int)csim.index_max();
 }
\ No newline at end of file
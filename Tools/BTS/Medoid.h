@@ -9,4 +9,7 @@
 // Medoid is the most representative object of a set.
 int CalculateMedoid(Matrix matrix, Metric metric, int n_atoms = 1);
 
+// Medoid of a dataset whose rows count weights(i) times.
+int CalculateMedoid(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms = 1);
+
 #endif // !MEDOID_H
\ No newline at end of file
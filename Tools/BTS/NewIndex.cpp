@@ -23,8 +23,8 @@ Returns
 int
     index of the new fingerprint to add to the selected indices.
 */
-uword GetNewIndexN(Matrix matrix, Metric metric, rvector select_condensed,
-    uword N, index_vec select_from_n, int n_atoms)
+uword GetNewIndexN(const Matrix &matrix, Metric metric, rvector select_condensed,
+    uword N, const index_vec &select_from_n, int n_atoms)
 {
     float sim_index;
     uword n_total = N + 1;
@@ -32,7 +32,7 @@ uword GetNewIndexN(Matrix matrix, Metric metric, rvector select_condensed,
     uword index = matrix.n_rows + 1;
     rvector sum;
 
-    for (uword i = 0; i < select_from_n.size(); i++){
+    for (uword i : select_from_n){
         sum = select_condensed + matrix.row(i);
         // The extended comparison call may not be the right one here, check to see
         sim_index = ExtendedComparison(
@@ -74,8 +74,8 @@ Returns
 int
     index of the new fingerprint to add to the selected indices.
 */
-uword GetNewIndexN(Matrix matrix, Metric metric, rvector select_condensed,
-    rvector sq_selected_condensed, uword N, index_vec select_from_n,
+uword GetNewIndexN(const Matrix &matrix, Metric metric, rvector select_condensed,
+    rvector sq_selected_condensed, uword N, const index_vec &select_from_n,
     int n_atoms)
 {
     float sim_index;
@@ -83,7 +83,7 @@ uword GetNewIndexN(Matrix matrix, Metric metric, rvector select_condensed,
     float min_value = -INFINITY;
     uword index = matrix.n_rows + 1;
 
-    for (uword i = 0; i < select_from_n.size(); i++){
+    for (uword i : select_from_n){
         // The extended comparison call may not be the right one here, check to see
         sim_index = ExtendedComparison(
             (select_condensed + matrix.row(i)), 
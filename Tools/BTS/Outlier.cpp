@@ -48,6 +48,32 @@ int CalculateOutlier(Matrix matrix, Metric metric, int n_atoms){
 
 }
 
+/*
+Calculates the outlier of a weighted dataset, where row i stands for weights(i) 
+identical objects. The result matches the outlier of the expanded dataset.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int, optional
+    Number of atoms in the system. Defaults to 1.
+
+Returns
+-------
+int
+    The index of the outlier in the dataset.
+*/
+int CalculateOutlier(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms)
+{
+    vector csim = CalculateCompSim(matrix, weights, metric, n_atoms);
+    return (int)csim.index_min();
+}
+
 
 /*
 Trims a desired percentage of outliers (most dissimilar) from the dataset 
@@ -120,9 +146,128 @@ However, if the criterion is 'sim_to_medoid', the highest indices are removed be
 Matrix TrimOutliers(
     Matrix matrix, int n_trimmed, Metric metric,
     int n_atoms, Criterion criterion){
-    
+
+    index_vec kept_indices = TrimOutlierIndices(matrix, n_trimmed, metric, n_atoms, criterion);
+
+    return matrix.rows(kept_indices);
+}
+
+/*
+Trims a desired percentage of outliers (most dissimilar) from the dataset 
+without copying it, returning the indices of the kept (or removed) rows.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+percent_trimmed : float
+    The desired fraction of outliers to be removed.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int
+    Number of atoms in the system.
+criterion : {'comp_sim', 'sim_to_medoid'}, optional
+    Criterion to use for data trimming. Defaults to 'comp_sim'.
+return_removed : bool, optional
+    Return the removed indices instead of the kept ones. Defaults to false.
+
+Returns
+-------
+index_vec
+    Ascending indices of the kept (or removed) rows.
+*/
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, float percent_trimmed, Metric metric,
+    int n_atoms, Criterion criterion, bool return_removed){
+
+    int N = matrix.n_rows;
+    int cutoff = int(floor(N * percent_trimmed));
+
+    return TrimOutlierIndices(matrix, cutoff, metric, n_atoms, criterion, return_removed);
+}
+
+/*
+Trims a certain amount (most dissimilar) from the dataset without copying it, 
+returning the indices of the kept (or removed) rows.
+
+The outlier scores are computed in parallel and only the n_trimmed most 
+dissimilar rows are selected, so callers (e.g. KmeansNANI) can work on the
+index set directly or gather the kept rows once.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+n_trimmed : int
+    The desired number of outliers to be removed.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int
+    Number of atoms in the system.
+criterion : {'comp_sim', 'sim_to_medoid'}, optional
+    Criterion to use for data trimming. Defaults to 'comp_sim'.
+return_removed : bool, optional
+    Return the removed indices instead of the kept ones. Defaults to false.
+
+Returns
+-------
+index_vec
+    Ascending indices of the kept (or removed) rows.
+*/
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, int n_trimmed, Metric metric,
+    int n_atoms, Criterion criterion, bool return_removed){
+
     uword N = matrix.n_rows;
-    int cutoff = n_trimmed;
+    uword cutoff = (n_trimmed > 0) ? (uword)n_trimmed : 0;
+    if (cutoff > N) {cutoff = N;}
+
+    vector values = OutlierScores(matrix, metric, n_atoms, criterion);
+
+    // The most dissimilar objects are the lowest comp sim or the highest
+    // dissimilarity to the medoid, their order does not matter
+    bool descend = (criterion == Criterion::SIM_TO_MEDOID);
+    index_vec removed = TopKIndices(values, cutoff, descend, false);
+
+    if (return_removed) {
+        return removed;
+    }
+
+    std::vector<bool> is_removed(N, false);
+    for (uword i : removed) {is_removed[i] = true;}
+
+    index_vec kept(N - removed.n_elem);
+    for (uword i = 0, j = 0; i < N; i++) {
+        if (!is_removed[i]) {kept(j++) = i;}
+    }
+
+    return kept;
+}
+
+/*
+Calculates the score used to trim outliers for every object of the dataset in parallel.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int
+    Number of atoms in the system.
+criterion : {'comp_sim', 'sim_to_medoid'}, optional
+    'comp_sim' returns the complementary similarity of each object (low is outlier).
+    'sim_to_medoid' returns the extended comparison of each object with the medoid (high is outlier).
+
+Returns
+-------
+vector
+    Score of each object.
+*/
+vector OutlierScores(const Matrix &matrix, Metric metric, int n_atoms, Criterion criterion)
+{
+    uword N = matrix.n_rows;
+    vector values(N, arma::fill::zeros);
 
     if (criterion == Criterion::SIM_TO_MEDOID) {
         int medoid_index = CalculateMedoid(matrix, metric, n_atoms);
@@ -140,53 +285,307 @@ Matrix TrimOutliers(
         } 
 
         rvector medoid = matrix.row(medoid_index);
-        // Remove the values from the medoid index of matrix
-        matrix.shed_row(medoid_index);
+        rvector sq_medoid = arma::pow(medoid, 2);
 
-        // Initialize values vector
-        rvector values(matrix.n_rows, arma::fill::zeros);
-        for (uword i = 0; i < matrix.n_rows; i++){
-            values(i) = ExtendedComparison(matrix.row(i), medoid, metric, n_atoms); // data_type = full?
+        // Extended comparison of each pair [object, medoid]
+        #pragma omp parallel for schedule(static)
+        for (uword i = 0; i < N; i++){
+            rvector c = matrix.row(i) + medoid;
+            rvector sq = arma::pow(matrix.row(i), 2) + sq_medoid;
+            values(i) = ExtendedComparison(c, sq, metric, 2, n_atoms);
         }
-
-        // Sort the values
-        index_vec sorted_indices = arma::sort_index(values);
-
-        // Collect the indices of the last cutoff elements of the sorted list
-        index_vec highest_indices = sorted_indices.subvec(sorted_indices.size()-cutoff, sorted_indices.size()-1);
-
-        // Remove the values at those indices of the original matrix
-        Matrix newMatrix(matrix);
-    
-        newMatrix.shed_rows(highest_indices);
-
-        return newMatrix;
-
     } else {
         rvector c_sum = arma::sum(matrix,COL);
         rvector sq_sum_total = arma::sum(arma::pow(matrix,2),COL);
-        rvector comp_sims;
-        float result;
-        rvector values (N, arma::fill::zeros);
+
+        #pragma omp parallel for schedule(static)
         for (uword i = 0; i < N; i++){
             rvector c = c_sum - matrix.row(i);
             rvector sq = sq_sum_total - (arma::pow(matrix.row(i),2));
-            result = ExtendedComparison(c, sq, metric, N-1, n_atoms);
-            values(i) = result;
+            values(i) = ExtendedComparison(c, sq, metric, N-1, n_atoms);
         }
+    }
 
-        // Sort the indices of the values
-        index_vec sorted_indices = arma::sort_index(values);
+    return values;
+}
 
-        // Collect the indices of the first cutoff elements of the sorted list
-        index_vec lowest_indices = sorted_indices.subvec(0, cutoff);
 
-        // Remove the values at those indices of the original matrix
-        Matrix newMatrix(matrix);
+/*
+Calculates the outlier score of every object of a weighted dataset. 
+'comp_sim' removes a single copy of each object from the weighted column sums 
+and 'sim_to_medoid' compares each object with the weighted medoid.
 
-        newMatrix.shed_rows(lowest_indices);
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+N_atoms : int
+    Number of atoms in the system.
+criterion : {'comp_sim', 'sim_to_medoid'}, optional
+    Score to compute, see OutlierScores.
+
+Returns
+-------
+vector
+    Score of each object.
+*/
+vector OutlierScores(
+    const Matrix &matrix, const arma::dvec &weights, Metric metric, 
+    int n_atoms, Criterion criterion)
+{
+    if (criterion != Criterion::SIM_TO_MEDOID) {
+        return CalculateCompSim(matrix, weights, metric, n_atoms);
+    }
+
+    uword N = matrix.n_rows;
+    vector values(N);
+    rvector medoid = matrix.row(CalculateMedoid(matrix, weights, metric, n_atoms));
+    rvector sq_medoid = arma::pow(medoid, 2);
 
-        return newMatrix;
+    // Extended comparison of each pair [object, medoid]
+    #pragma omp parallel for schedule(static)
+    for (uword i = 0; i < N; i++){
+        rvector c = matrix.row(i) + medoid;
+        rvector sq = arma::pow(matrix.row(i), 2) + sq_medoid;
+        values(i) = ExtendedComparison(c, sq, metric, 2, n_atoms);
     }
 
+    return values;
 }
+
+/*
+Trims a desired fraction of the total weight of a weighted dataset, removing 
+the most dissimilar objects first. When the cutoff falls inside the weight of 
+a row, only part of that row is removed and its weight is reduced, so the 
+result matches trimming the expanded dataset.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+weights : arma::dvec
+    Weight of each row.
+percent_trimmed : float
+    The desired fraction of the total weight to be removed.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+kept_weights : arma::dvec
+    Output, remaining weight of each kept row.
+N_atoms : int
+    Number of atoms in the system.
+criterion : {'comp_sim', 'sim_to_medoid'}, optional
+    Criterion to use for data trimming. Defaults to 'comp_sim'.
+
+Returns
+-------
+index_vec
+    Ascending indices of the kept rows.
+*/
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, const arma::dvec &weights, float percent_trimmed, Metric metric,
+    arma::dvec &kept_weights, int n_atoms, Criterion criterion)
+{
+    if (weights.n_elem != matrix.n_rows) {
+        throw std::invalid_argument("The number of weights does not match the number of rows.\n");
+    }
+
+    double cutoff = floor(arma::accu(weights) * percent_trimmed);
+
+    vector values = OutlierScores(matrix, weights, metric, n_atoms, criterion);
+
+    // Most dissimilar objects first, ties keep the row order
+    bool descend = (criterion == Criterion::SIM_TO_MEDOID);
+    index_vec order = TopWeightIndices(values, weights, cutoff, descend);
+
+    arma::dvec remaining = weights;
+    for (uword k = 0; (k < order.n_elem) && (cutoff > 0); k++) {
+        uword i = order(k);
+        double removed = std::min(remaining(i), cutoff);
+        remaining(i) -= removed;
+        cutoff -= removed;
+    }
+
+    index_vec kept = arma::find(remaining > 0);
+    kept_weights = remaining.elem(kept);
+
+    return kept;
+}
+
+/*
+Trims a desired fraction of the total weight of a weighted dataset. 
+See TrimOutlierIndices(weights).
+
+Returns
+-------
+Matrix
+    The kept rows, their remaining weights are returned in kept_weights.
+*/
+Matrix TrimOutliers(
+    const Matrix &matrix, const arma::dvec &weights, float percent_trimmed, Metric metric,
+    arma::dvec &kept_weights, int n_atoms, Criterion criterion)
+{
+    index_vec kept = TrimOutlierIndices(
+        matrix, weights, percent_trimmed, metric, kept_weights, n_atoms, criterion);
+    return matrix.rows(kept);
+}
+
+
+/*
+Trims a desired percentage of outliers from the dataset in several rounds 
+based on the complementary similarity. See IterativeTrimOutlierIndices(int).
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+percent_trimmed : float
+    The total fraction of outliers to be removed over all rounds.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+n_rounds : int
+    Number of trimming rounds.
+N_atoms : int
+    Number of atoms in the system.
+return_removed : bool, optional
+    Return the removed indices instead of the kept ones. Defaults to false.
+
+Returns
+-------
+index_vec
+    Ascending indices of the kept (or removed) rows.
+*/
+index_vec IterativeTrimOutlierIndices(
+    const Matrix &matrix, float percent_trimmed, Metric metric, int n_rounds,
+    int n_atoms, bool return_removed){
+
+    int N = matrix.n_rows;
+    int cutoff = int(floor(N * percent_trimmed));
+
+    return IterativeTrimOutlierIndices(matrix, cutoff, metric, n_rounds, n_atoms, return_removed);
+}
+
+/*
+Trims a certain amount of outliers from the dataset in several rounds based 
+on the complementary similarity, so outliers that only stand out once others 
+are gone are also removed.
+
+The column sums are computed once and the rows removed in a round are 
+subtracted from them, then the complementary similarity is recomputed only 
+for the surviving objects. For MSD the complementary similarity of object i is
+
+    2 * ((N-1) * sum(sq_sum) - |c_sum|^2 + |c_sum|^2 / N - N * |x_i - c_sum/N|^2) / ((N-1)^2 * n_atoms)
+
+so each round is a single column-wise pass over the survivors.
+
+Parameters
+----------
+matrix : Matrix
+    Input data matrix.
+n_trimmed : int
+    The total number of outliers to be removed, split evenly over the rounds.
+metric : {'MSD', 'RR', 'JT', 'SM', etc}
+    Metric used for extended comparisons. See `extended_comparison` for details.
+n_rounds : int
+    Number of trimming rounds.
+N_atoms : int
+    Number of atoms in the system.
+return_removed : bool, optional
+    Return the removed indices instead of the kept ones. Defaults to false.
+
+Returns
+-------
+index_vec
+    Ascending indices of the kept (or removed) rows.
+*/
+index_vec IterativeTrimOutlierIndices(
+    const Matrix &matrix, int n_trimmed, Metric metric, int n_rounds,
+    int n_atoms, bool return_removed){
+
+    uword N_total = matrix.n_rows;
+    uword n_cols = matrix.n_cols;
+    uword total_cutoff = (n_trimmed > 0) ? (uword)n_trimmed : 0;
+    if (total_cutoff > N_total) {total_cutoff = N_total;}
+    if (n_rounds < 1) {n_rounds = 1;}
+
+    // Condensed sums of the surviving objects
+    arma::drowvec c_sum = arma::conv_to<arma::drowvec>::from(arma::sum(matrix, COL));
+    arma::drowvec sq_sum = arma::conv_to<arma::drowvec>::from(arma::sum(arma::pow(matrix, 2), COL));
+
+    index_vec active = arma::regspace<index_vec>(0, N_total-1);
+    std::vector<bool> is_removed(N_total, false);
+    uword n_removed = 0;
+
+    for (int round = 0; round < n_rounds; round++) {
+        uword N = active.n_elem;
+        uword cutoff = total_cutoff * (round + 1) / n_rounds - n_removed;
+        if ((cutoff == 0) || (N < 2)) {continue;}
+
+        vector values(N);
+
+        if (metric == Metric::MSD) {
+            arma::drowvec mean = c_sum / N;
+            arma::dvec dist(N, arma::fill::zeros);
+
+            // Column-wise pass over blocks of survivors, blocks are split between threads
+            const uword block = 256;
+            #pragma omp parallel for schedule(static)
+            for (uword b = 0; b < N; b += block) {
+                uword b_end = std::min(b + block, N);
+                for (uword j = 0; j < n_cols; j++) {
+                    const float *column = matrix.colptr(j);
+                    double m = mean(j);
+                    for (uword a = b; a < b_end; a++) {
+                        double d = column[active(a)] - m;
+                        dist(a) += d * d;
+                    }
+                }
+            }
+
+            double c_norm = arma::dot(c_sum, c_sum);
+            double constant = (N - 1.0) * arma::accu(sq_sum) - c_norm + c_norm / N;
+            double scale = 2.0 / (std::pow(N - 1.0, 2) * n_atoms);
+            for (uword a = 0; a < N; a++) {
+                values(a) = scale * (constant - N * dist(a));
+            }
+        } else {
+            rvector c_total = arma::conv_to<rvector>::from(c_sum);
+            rvector sq_total = arma::conv_to<rvector>::from(sq_sum);
+
+            #pragma omp parallel for schedule(static)
+            for (uword a = 0; a < N; a++) {
+                rvector c = c_total - matrix.row(active(a));
+                rvector sq = sq_total - arma::pow(matrix.row(active(a)), 2);
+                values(a) = ExtendedComparison(c, sq, metric, N-1, n_atoms);
+            }
+        }
+
+        // Lowest complementary similarities are the outliers of this round
+        index_vec lowest = TopKIndices(values, cutoff, false, false);
+        index_vec removed_rows = active.elem(lowest);
+
+        for (uword i : removed_rows) {
+            arma::drowvec row = arma::conv_to<arma::drowvec>::from(matrix.row(i));
+            c_sum -= row;
+            sq_sum -= arma::square(row);
+            is_removed[i] = true;
+        }
+        n_removed += removed_rows.n_elem;
+
+        active.shed_rows(lowest);
+    }
+
+    if (!return_removed) {
+        return active;
+    }
+
+    index_vec removed(n_removed);
+    for (uword i = 0, j = 0; i < N_total; i++) {
+        if (is_removed[i]) {removed(j++) = i;}
+    }
+
+    return removed;
+}
\ No newline at end of file
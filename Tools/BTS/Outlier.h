@@ -9,6 +9,9 @@
 // Outliers are the least representative objects of a set.
 int CalculateOutlier(Matrix matrix, Metric metric, int n_atoms = 1);
 
+// Outlier of a dataset whose rows count weights(i) times.
+int CalculateOutlier(const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms = 1);
+
 // Trims a desired percentage of outliers (most dissimilar) from the dataset 
 // by calculating largest complement similarity.
 Matrix TrimOutliers(
@@ -18,4 +21,37 @@ Matrix TrimOutliers(
     Matrix matrix, int n_trimmed, Metric metric,
     int n_atoms=1, Criterion criterion = Criterion::COMP_SIM);
 
+// Trims outliers without copying the data, returning the kept (or removed) row indices.
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, float percent_trimmed, Metric metric,
+    int n_atoms=1, Criterion criterion = Criterion::COMP_SIM, bool return_removed = false);
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, int n_trimmed, Metric metric,
+    int n_atoms=1, Criterion criterion = Criterion::COMP_SIM, bool return_removed = false);
+
+// Trims a fraction of the total weight of a weighted dataset, the boundary row is trimmed
+// partially. Returns the kept row indices and their remaining weights in kept_weights.
+index_vec TrimOutlierIndices(
+    const Matrix &matrix, const arma::dvec &weights, float percent_trimmed, Metric metric,
+    arma::dvec &kept_weights, int n_atoms=1, Criterion criterion = Criterion::COMP_SIM);
+Matrix TrimOutliers(
+    const Matrix &matrix, const arma::dvec &weights, float percent_trimmed, Metric metric,
+    arma::dvec &kept_weights, int n_atoms=1, Criterion criterion = Criterion::COMP_SIM);
+
+// Trims outliers in several rounds, updating the column sums and rescoring only the survivors.
+index_vec IterativeTrimOutlierIndices(
+    const Matrix &matrix, float percent_trimmed, Metric metric, int n_rounds,
+    int n_atoms = 1, bool return_removed = false);
+index_vec IterativeTrimOutlierIndices(
+    const Matrix &matrix, int n_trimmed, Metric metric, int n_rounds,
+    int n_atoms = 1, bool return_removed = false);
+
+// Score used to rank outliers for every object of the dataset.
+vector OutlierScores(
+    const Matrix &matrix, Metric metric, int n_atoms = 1,
+    Criterion criterion = Criterion::COMP_SIM);
+vector OutlierScores(
+    const Matrix &matrix, const arma::dvec &weights, Metric metric, int n_atoms = 1,
+    Criterion criterion = Criterion::COMP_SIM);
+
 #endif // !OUTLIER_H
\ No newline at end of file